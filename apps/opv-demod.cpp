@@ -6,18 +6,26 @@
 #include "FirFilter.h"
 
 #include "Numerology.h"
+#include "OutputSink.h"
+#include "queue.h"
 #include <opus/opus.h>
 
 #include <boost/program_options.hpp>
 #include <boost/optional.hpp>
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
 #include <vector>
 
 const char VERSION[] = "0.2";
@@ -28,6 +36,7 @@ uint32_t debug_sample_count = 0;
 
 OpusDecoder* opus_decoder;
 OPVCobsDecoder cobs_decoder;
+OutputSink output;      // stdout
 
 PRBS9 prbs;
 
@@ -38,6 +47,10 @@ struct Config
     bool quiet = false;
     bool invert = false;
     bool noise_blanker = false;
+    bool fixed_point = false;
+    bool squelch = false;
+    bool pipeline = false;
+    bool find_sync = false;
 
     static std::optional<Config> parse(int argc, char* argv[])
     {
@@ -53,6 +66,10 @@ struct Config
             ("version,V", "Print the application version and exit.")
             ("invert,i", po::bool_switch(&result.invert), "invert the received baseband")
             ("noise-blanker,b", po::bool_switch(&result.noise_blanker), "noise blanker -- silence likely corrupt audio")
+            ("fixed,F", po::bool_switch(&result.fixed_point), "integer matched filter -- the rest of the demodulator stays floating point")
+            ("squelch,S", po::bool_switch(&result.squelch), "zero crossing squelch -- skip carrier detection on an idle channel")
+            ("find-sync,s", po::bool_switch(&result.find_sync), "list the sync words found in a recording and exit")
+            ("pipeline,p", po::bool_switch(&result.pipeline), "run reading, demodulation and audio decoding in separate threads")
             ("verbose,v", po::bool_switch(&result.verbose), "verbose output")
             ("debug,d", po::bool_switch(&result.debug), "debug-level output")
             ("quiet,q", po::bool_switch(&result.quiet), "silence all output -- no BERT output")
@@ -116,7 +133,7 @@ void decode_and_output_audio(const uint8_t *encoded_audio, int encoded_len, int
         count = opus_decode(opus_decoder, encoded_audio, opus_packet_size_bytes, buf.data(), audio_samples_per_opv_frame, 0);
     }
 
-    std::cout.write((const char*)buf.data(), audio_bytes_per_opv_frame);
+    output.write_le(buf.data(), buf.size());
 
     if (config->verbose && count != audio_samples_per_opv_frame)
     {
@@ -226,6 +243,184 @@ void dummy_packet_callback(const uint8_t *buf, unsigned int len)
 }
 
 
+// Offline search of a recording.  The whole input is filtered, then the
+// preamble and STREAM sync words are searched for in one pass, with the
+// demodulator's trigger levels.  Offsets are in filtered samples, as
+// debug_sample_count.
+template <typename FloatType>
+void find_sync(OPVDemodulator<FloatType>& demod, FloatType scale)
+{
+    std::vector<int16_t> raw;
+    std::array<int16_t, 4096> samples;
+    while (std::cin)
+    {
+        std::cin.read(reinterpret_cast<char*>(samples.data()), sizeof(samples));
+        raw.insert(raw.end(), samples.begin(), samples.begin() + std::cin.gcount() / sizeof(int16_t));
+    }
+
+    std::vector<FloatType> input(raw.size());
+    std::vector<FloatType> filtered(raw.size());
+    std::transform(raw.begin(), raw.end(), input.begin(), [scale](int16_t x) { return x * scale; });
+    FirFilter<FloatType, detail::Taps<FloatType>::rrc_taps.size()> filter{detail::Taps<FloatType>::rrc_taps};
+    filter(input.data(), filtered.data(), input.size());
+
+    using search_t = SyncSearch<FloatType, 2>;
+    const auto& preamble = demod.preamble_sync;
+    const auto& stream = demod.stream_sync;
+    auto search = std::make_unique<search_t>(std::array<typename search_t::Pattern, 2>{{
+        {preamble.sync_word_, preamble.magnitude_1_, preamble.magnitude_2_},
+        {stream.sync_word_, stream.magnitude_1_, stream.magnitude_2_}}});
+
+    for (const auto& candidate : (*search)(filtered.data(), filtered.size()))
+    {
+        std::cout << (candidate.word == 0 ? "Preamble" : "STREAM sync word")
+            << " at sample " << candidate.offset
+            << " (" << float(candidate.offset)/samples_per_frame << " frames)"
+            << ", phase " << candidate.phase()
+            << ", correlation " << candidate.value << std::endl;
+    }
+}
+
+// In pipelined mode the work is split over three threads, connected by
+// spsc_queues: the reader, the DSP stage (demodulation through frame
+// decoding, and BERT) and the codec stage (COBS, Opus and audio output).
+// Sample blocks are passed by pointer from a pool, as in opv-mod; decoded
+// frames are small and are copied.
+constexpr size_t sample_block_size = 4096;  // about 15ms of baseband at 271 kS/s
+constexpr size_t sample_pool_size = 32;
+constexpr size_t frame_queue_size = 64;     // 2.56s of frames
+
+using sample_block_t = std::array<int16_t, sample_block_size>;
+
+struct sample_block_ref
+{
+    sample_block_t* block = nullptr;
+    size_t count = 0;       // samples read into the block
+};
+
+struct payload_frame
+{
+    OPVFrameDecoder::stream_type1_bytes_t data;
+    bool resync = false;    // the COBS decoder is reset before this frame
+};
+
+struct pipeline_t
+{
+    using block_queue_t = spsc_queue<sample_block_ref, sample_pool_size>;
+
+    std::array<sample_block_t, sample_pool_size> blocks;
+    block_queue_t full_blocks;
+    block_queue_t free_blocks;
+    spsc_queue<payload_frame, frame_queue_size> frames;
+
+    // The codec stage's COBS decoder, used in place of cobs_decoder.  A
+    // sync event from the demodulator is passed on with the next frame.
+    OPVCobsDecoder cobs;
+    bool resync = false;    // DSP stage only
+
+    pipeline_t()
+    {
+        for (auto& block : blocks) free_blocks.put(sample_block_ref{&block, 0});
+        cobs.set_packet_callback(dummy_packet_callback);
+    }
+
+    // Sync callback for the DSP stage.
+    void sync()
+    {
+        resync = true;
+    }
+
+    // Frame callback for the DSP stage.
+    bool handle_frame(OPVFrameDecoder::output_buffer_t const& frame, int)
+    {
+        using FrameType = OPVFrameDecoder::FrameType;
+
+        switch (frame.type)
+        {
+            case FrameType::OPV_COBS:
+            {
+                frames.put(payload_frame{frame.data, resync});
+                resync = false;
+                break;
+            }
+            case FrameType::OPV_BERT:
+                return decode_bert(frame.data);
+        }
+
+        return true;
+    }
+
+    template <typename FloatType>
+    void dsp(OPVDemodulator<FloatType>& demod, FloatType scale)
+    {
+        sample_block_ref ref;
+        while (full_blocks.get(ref))
+        {
+            demod.process(std::span<const int16_t>(ref.block->data(), ref.count), scale);
+            free_blocks.put(ref);
+        }
+        frames.close();
+    }
+
+    void codec()
+    {
+        payload_frame payload;
+        while (frames.get(payload))
+        {
+            if (payload.resync) cobs.reset();
+            cobs(payload.data.data(), stream_frame_payload_bytes);
+            if (frames.empty()) output.flush();     // nothing more decoded yet
+        }
+        output.flush();
+    }
+
+    static std::string waits(size_t count, std::chrono::nanoseconds time)
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time);
+        return std::to_string(count) + " times, " + std::to_string(ms.count()) + "ms";
+    }
+
+    void report() const
+    {
+        auto full = full_blocks.stats();
+        auto free = free_blocks.stats();
+        auto decoded = frames.stats();
+
+        // The reader stalls when the pool is used up, waiting for the DSP
+        // stage to return a block.
+        std::cerr << "Sample blocks: max queued " << full.max_size << "/" << sample_pool_size
+            << ", reader stalled " << waits(free.get_waits, free.get_wait_time)
+            << ", DSP idle " << waits(full.get_waits, full.get_wait_time) << std::endl;
+        std::cerr << "Frames: max queued " << decoded.max_size << "/" << frame_queue_size
+            << ", DSP stalled " << waits(decoded.put_waits, decoded.put_wait_time)
+            << ", codec idle " << waits(decoded.get_waits, decoded.get_wait_time) << std::endl;
+    }
+};
+
+template <typename FloatType>
+void run_pipeline(pipeline_t& pipeline, OPVDemodulator<FloatType>& demod, FloatType scale)
+{
+    std::thread dsp([&](){ pipeline.dsp(demod, scale); });
+    std::thread codec([&](){ pipeline.codec(); });
+
+    sample_block_ref ref;
+    while (pipeline.free_blocks.get(ref))
+    {
+        std::cin.read(reinterpret_cast<char*>(ref.block->data()), ref.block->size() * sizeof(int16_t));
+        ref.count = std::cin.gcount() / sizeof(int16_t);
+        if (ref.count != 0) pipeline.full_blocks.put(ref);
+        if (!std::cin) break;
+    }
+
+    pipeline.full_blocks.close();
+    dsp.join();
+    codec.join();
+
+    std::cerr << "Input EOF at sample " << debug_sample_count << std::endl;
+    if (!config->quiet) pipeline.report();
+}
+
+
 int main(int argc, char* argv[])
 {
     config = Config::parse(argc, argv);
@@ -242,23 +437,51 @@ int main(int argc, char* argv[])
 
     using FloatType = float;
 
-    OPVDemodulator<FloatType> demod(handle_frame);
+    std::unique_ptr<pipeline_t> pipeline;
+    OPVDemodulator<FloatType>::callback_t frame_callback = handle_frame;
+    if (config->pipeline)
+    {
+        pipeline = std::make_unique<pipeline_t>();
+        frame_callback = [&pipeline](auto const& frame, int viterbi_cost) {
+            return pipeline->handle_frame(frame, viterbi_cost);
+        };
+    }
+
+    OPVDemodulator<FloatType> demod(frame_callback);
     cobs_decoder.set_packet_callback(dummy_packet_callback);
+    if (pipeline) demod.on_sync([&pipeline]() { pipeline->sync(); });
 
     demod.diagnostics(diagnostic_callback<FloatType>);
+    demod.fixed_point(config->fixed_point);
+    demod.squelch_enabled(config->squelch);
 
-    while (std::cin)
+    // Scale 16-bit samples to [-0.74472727,0.744704545], inverting if requested.
+    const FloatType scale = (config->invert ? -1.0 : 1.0) / 44000.0;
+
+    if (config->find_sync)
+    {
+        find_sync(demod, scale);
+    }
+    else if (pipeline)
+    {
+        run_pipeline(*pipeline, demod, scale);
+    }
+    else
     {
-        int16_t sample;
-        std::cin.read(reinterpret_cast<char*>(&sample), 2);
-        if (std::cin.eof())
+        std::array<int16_t, sample_block_size> samples;
+
+        while (std::cin)
         {
-            std::cerr << "Input EOF at sample " << debug_sample_count << std::endl;
-            break;
+            std::cin.read(reinterpret_cast<char*>(samples.data()), sizeof(samples));
+            size_t count = std::cin.gcount() / sizeof(int16_t);
+            demod.process(std::span<const int16_t>(samples.data(), count), scale);
+            output.flush();     // audio decoded from this block
+            if (std::cin.eof())
+            {
+                std::cerr << "Input EOF at sample " << debug_sample_count << std::endl;
+                break;
+            }
         }
-        if (config->invert) sample *= -1;
-        demod(sample / 44000.0);    // scale 16-bit sample to [-0.74472727,0.744704545] and process
-        debug_sample_count++;
     }
 
     std::cerr << std::endl;
@@ -11,6 +11,7 @@
 #include "Golay24.h"
 #include "OPVFrameHeader.h"
 #include "UDPNetwork.h"
+#include "OutputSink.h"
 #include "cobs.h"
 
 #include "Numerology.h"
@@ -55,6 +56,7 @@ struct Config
     uint64_t token = 0; // authentication token for frame header
     bool invert = false;
     bool preamble_only = false;
+    bool fixed_point = false;
 
     static std::optional<Config> parse(int argc, char* argv[])
     {
@@ -84,6 +86,7 @@ struct Config
                 "number of BERT frames to output (default or 0 to read audio from STDIN instead).")
             ("invert,i", po::bool_switch(&result.invert), "invert the output baseband (ignored for bitstream)")
             ("preamble,P", po::bool_switch(&result.preamble_only), "preamble-only output")
+            ("fixed,F", po::bool_switch(&result.fixed_point), "integer-only baseband generation (within 1 LSB of the default)")
             ("verbose,v", po::bool_switch(&result.verbose), "verbose output")
             ("debug,d", po::bool_switch(&result.debug), "debug-level output")
             ("quiet,q", po::bool_switch(&result.quiet), "silence all output")
@@ -136,6 +139,7 @@ std::optional<Config> config;
 
 std::atomic<bool> running{false};
 UDPNetwork udp;
+OutputSink output;      // stdout
 
 bool invert = false;
 
@@ -201,18 +205,31 @@ std::array<int16_t, N*10> symbols_to_baseband(std::array<int8_t, N> symbols)
 {
     using namespace mobilinkd;
 
-    static BaseFirFilter<double, std::tuple_size<decltype(rrc_taps)>::value> rrc = makeFirFilter(rrc_taps);
+    constexpr size_t taps = std::tuple_size<decltype(rrc_taps)>::value;
+    static FirInterpolator<double, taps, 10> rrc(rrc_taps);
+
+    const double scale = 7168.0 * (invert ? -1.0 : 1.0);
 
     std::array<int16_t, N*10> baseband;
-    baseband.fill(0);
-    for (size_t i = 0; i != symbols.size(); ++i)
+
+    if (config->fixed_point)
     {
-        baseband[i * 10] = symbols[i];
+        static FixedPointInterpolator<taps, 10> fixed_rrc(rrc_taps, scale);
+        for (size_t i = 0; i != symbols.size(); ++i)
+        {
+            fixed_rrc(symbols[i], baseband.data() + i * 10);
+        }
+        return baseband;
     }
 
-    for (auto& b : baseband)
+    std::array<double, 10> samples;
+    for (size_t i = 0; i != symbols.size(); ++i)
     {
-        b = rrc(b) * 7168.0 * (invert ? -1.0 : 1.0);
+        rrc(symbols[i], samples.data());
+        for (size_t j = 0; j != samples.size(); ++j)
+        {
+            baseband[i * 10 + j] = samples[j] * scale;
+        }
     }
 
     return baseband;
@@ -246,10 +263,10 @@ void output_bitstream_to_UDP(std::array<uint8_t, 2> sync_word, const bitstream_t
 }
 
 
-// output a frame of type4 bits, including the sync word, to cout (packed)
+// output a frame of type4 bits, including the sync word, to stdout (packed)
 void output_bitstream_to_stdout(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
 {
-    for (auto c : sync_word) std::cout << c;        // output the sync word
+    output.write(sync_word.data(), sync_word.size());   // output the sync word
     for (size_t i = 0; i != frame.size(); i += 8)   // output the fheader and data
     {
         uint8_t c = 0;
@@ -258,7 +275,7 @@ void output_bitstream_to_stdout(std::array<uint8_t, 2> sync_word, const bitstrea
             c <<= 1;
             c |= frame[i + j];
         }
-        std::cout << c;
+        output.put(c);
     }
 }
 
@@ -277,7 +294,7 @@ void output_bitstream(std::array<uint8_t, 2> sync_word, const bitstream_t& frame
 }
 
 
-// output a frame of modulation samples, including the sync word, to cout
+// output a frame of modulation samples, including the sync word, to stdout
 void output_baseband(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
 {
     auto sw = bytes_to_symbols(sync_word);
@@ -287,7 +304,7 @@ void output_baseband(std::array<uint8_t, 2> sync_word, const bitstream_t& frame)
     auto fit = std::copy(sw.begin(), sw.end(), temp.begin());
     std::copy(symbols.begin(), symbols.end(), fit);
     auto baseband = symbols_to_baseband(temp);
-    for (auto b : baseband) std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
+    output.write_le(baseband.data(), baseband.size());
 }
 
 
@@ -312,14 +329,14 @@ void send_constant_frame(const uint8_t value)
         }
         else
         {
-            for (auto c : preamble_bytes) std::cout << c;
+            output.write(preamble_bytes.data(), preamble_bytes.size());
         }
     }
     else // baseband
     {
         auto preamble_symbols = bytes_to_symbols(preamble_bytes);
         auto preamble_baseband = symbols_to_baseband(preamble_symbols);
-        for (auto b : preamble_baseband) std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
+        output.write_le(preamble_baseband.data(), preamble_baseband.size());
     }
 
 }
@@ -357,8 +374,8 @@ void output_eot()
 {
     if (config->bitstream)
     {
-        for (auto c : EOT_SYNC) std::cout << c;
-        for (size_t i = 0; i !=10; ++i) std::cout << '\0'; // Flush the imaginary RRC FIR Filter.
+        output.write(EOT_SYNC.data(), EOT_SYNC.size());
+        for (size_t i = 0; i !=10; ++i) output.put(0); // Flush the imaginary RRC FIR Filter.
     }
     else // baseband
     {
@@ -370,15 +387,15 @@ void output_eot()
             out_symbols[i] = symbols[i];
         }
         auto baseband = symbols_to_baseband(out_symbols);
-        for (auto b : baseband) std::cout << uint8_t(b & 0xFF) << uint8_t(b >> 8);
+        output.write_le(baseband.data(), baseband.size());
     }
+    output.flush();
 }
 
 
 using fheader_t = std::array<uint8_t, fheader_size_bytes>;          // Frame Header (type 1)
 using encoded_fheader_t = std::array<int8_t, encoded_fheader_size>; // Frame Header (type 2/3)
 
-using queue_t = queue<int16_t, audio_samples_per_opv_frame>; // the queue can hold up to 40ms worth of PCM audio samples
 using audio_frame_t = std::array<int16_t, audio_samples_per_opv_frame>;    // an audio frame is 40ms worth of PCM audio samples
 using stream_frame_t = std::array<uint8_t, stream_frame_payload_bytes>; // a stream frame of type1 data bytes
 using type3_data_frame_t = std::array<uint8_t, stream_type3_payload_size>;  // a stream frame of type3 bits
@@ -450,6 +467,32 @@ void cobs_encode_voice_frame(uint8_t* frame, uint8_t* cobs_frame)
     }
 }
 
+// Audio frames are passed from the stdin reader to the transmit thread
+// without copying.  The reader fills a frame from the pool and queues it
+// as full; the transmit thread encodes it and queues it back as free.
+constexpr size_t audio_frame_pool_size = 4;     // 160ms of PCM audio
+
+struct audio_frame_ref
+{
+    audio_frame_t* frame = nullptr;
+    size_t count = 0;       // samples read into the frame
+};
+
+struct audio_frame_pool
+{
+    using queue_t = spsc_queue<audio_frame_ref, audio_frame_pool_size>;
+
+    std::array<audio_frame_t, audio_frame_pool_size> frames;
+    queue_t full_frames;
+    queue_t free_frames;
+
+    audio_frame_pool()
+    {
+        for (auto& frame : frames) free_frames.put(audio_frame_ref{&frame, 0});
+    }
+};
+
+
 // Create the payload for a OPV-RPC frame, which contains a single 40ms Opus packet
 // wrapped in RTP, UDP, and IP, and then framed with COBS.
 stream_frame_t fill_voice_frame(OpusEncoder *opus_encoder, const audio_frame_t& audio)
@@ -650,7 +693,7 @@ void send_stream_frame(const encoded_fheader_t& fh, const type3_data_frame_t& da
 
 // Thread function that receives PCM audio samples on a queue and transmits OPV.
 // (preamble has already been sent, and fheader has been filled.)
-void transmit(queue_t& queue, fheader_t& fh)
+void transmit(audio_frame_pool& pool, fheader_t& fh)
 {
     int encoder_err;    // return code from Opus function calls
 
@@ -682,32 +725,24 @@ void transmit(queue_t& queue, fheader_t& fh)
         abort();
     }
 
-    audio_frame_t audio;
-    size_t index = 0;
+    audio_frame_ref ref;
 
-    while (!queue.is_closed() && queue.empty()) std::this_thread::yield();
-    while (!queue.is_closed())
+    while (!pool.full_frames.is_closed() && pool.full_frames.empty()) std::this_thread::yield();
+    while (pool.full_frames.get(ref, std::chrono::milliseconds(3000))) //!!! this could be smarter
     {
-        int16_t sample;
-        if (!queue.get(sample, std::chrono::milliseconds(3000))) break; //!!! this could be smarter
-        audio[index++] = sample;
-        if (index == audio.size())
-        {
-            index = 0;
-            auto type4_data = encode_stream_frame(fill_voice_frame(opus_encoder, audio));
-            send_stream_frame(efh, type4_data);
-            audio.fill(0);
-        } 
-    }
-
-    if (index > 0)
-    {
-        // send partial frame;
+        // A partial frame is the end of the input; pad it with silence.
+        auto& audio = *ref.frame;
+        std::fill(audio.begin() + ref.count, audio.end(), 0);
         auto type4_data = encode_stream_frame(fill_voice_frame(opus_encoder, audio));
         send_stream_frame(efh, type4_data);
+        pool.free_frames.put(ref);
+        // The audio may be live, so send each frame as soon as it is ready
+        // rather than when the output buffer fills.
+        output.flush();
     }
 
     // Last frame is an extra frame of silence.
+    audio_frame_t audio;
     audio.fill(0);
     auto type4_data = encode_stream_frame(fill_voice_frame(opus_encoder, audio));
     set_last_frame_bit(fh);
@@ -822,24 +857,28 @@ int main(int argc, char* argv[])
         send_dead_carrier();    // simulate loss of signal
     } else {    // Normal mode (voice, data)
         running = true;
-        queue_t queue;
-        std::thread thd([&queue, &fh](){transmit(queue, fh);});
+        audio_frame_pool pool;
+        std::thread thd([&pool, &fh](){transmit(pool, fh);});
 
         std::cerr << "opv-mod running. ctrl-D to break." << std::endl;
 
         // Input must be 48000 SPS, 16-bit LE, 1 channel raw audio.
-        while (running)
+        // It is read straight into a free frame, a frame at a time.
+        audio_frame_ref ref;
+        while (running && pool.free_frames.get(ref, std::chrono::seconds(300)))
         {
-            int16_t sample;
-            if (!std::cin.read(reinterpret_cast<char*>(&sample), 2)) break;
-            if (!queue.put(sample, std::chrono::seconds(300))) break;
+            std::cin.read(reinterpret_cast<char*>(ref.frame->data()), ref.frame->size() * 2);
+            ref.count = std::cin.gcount() / 2;
+            if (ref.count != 0) pool.full_frames.put(ref);
+            if (ref.count != ref.frame->size()) break;
         }
 
         running = false;
 
-        queue.close();
+        pool.full_frames.close();
         thd.join();
     }
-    
+
+    output.flush();
     return EXIT_SUCCESS;
 }
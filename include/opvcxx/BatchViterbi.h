@@ -0,0 +1,388 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Viterbi.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * Viterbi decoder for a batch of independent frames.
+ *
+ * The frames are laid out across lanes.  Each path metric is a vector of
+ * Lanes int16 values, one per frame, so with 16 lanes a single AVX2
+ * register holds one state's metric for all 16 frames.  The butterflies
+ * then need no shuffles between states.  This gives up latency for
+ * throughput, for offline re-decoding and for receivers with many channels.
+ *
+ * The output and cost for each frame are the same as from
+ * Viterbi::decode().  The int16 metric bounds and renormalization are the
+ * ones proven in Viterbi.
+ */
+template <typename Trellis_, size_t LLR_ = 2, size_t Lanes = 16>
+struct BatchViterbi
+{
+    using viterbi_t = Viterbi<Trellis_, LLR_>;
+
+    static constexpr size_t NumStates = viterbi_t::NumStates;
+    static constexpr size_t RENORM_INTERVAL = viterbi_t::RENORM_INTERVAL;
+    static constexpr int16_t METRIC16_INIT = viterbi_t::METRIC16_INIT;
+
+    // A rate 1/2 shift register code, so butterfly j feeds states 2j and
+    // 2j+1 and the predecessor of a state is found with shifts.
+    static_assert(Trellis_::n == 2 && Trellis_::k == 1);
+    static_assert(Lanes <= 32);
+
+    using lane_mask_t = std::conditional_t<Lanes <= 16, uint16_t, uint32_t>;
+    using lanes_t = std::array<int16_t, Lanes>;
+
+    viterbi_t viterbi_;                 // Trellis tables.
+    SimdLevel simd_ = simd_level();     // Set to SCALAR to force the lane loops.
+
+    // Index into the four branch costs for the first branch of each
+    // butterfly.  The second branch uses the opposite signs.
+    std::array<uint8_t, NumStates / 2> branch_;
+    int16_t limit_;
+
+    alignas(32) std::array<lanes_t, NumStates> metrics_;
+    std::array<int32_t, Lanes> offset_;
+    std::vector<lanes_t> llr_;                                  // llr_[i][lane]
+    std::vector<std::array<lane_mask_t, NumStates>> history_;   // history_[step][state]
+
+    BatchViterbi(Trellis_ trellis)
+    : viterbi_(trellis)
+    {
+        for (size_t j = 0; j != NumStates / 2; ++j)
+        {
+            branch_[j] = (viterbi_.cost_[j][0] > 0) * 2 + (viterbi_.cost_[j][1] > 0);
+        }
+        limit_ = std::abs(viterbi_.cost_[0][0]);
+    }
+
+    /**
+     * Decode up to Lanes frames.  Null entries in @p in are skipped and
+     * get no output.
+     *
+     * @return the path metric of each frame, as from Viterbi::decode().
+     */
+    template <size_t IN, size_t OUT>
+    std::array<size_t, Lanes> decode(
+        const std::array<const std::array<int8_t, IN>*, Lanes>& in,
+        const std::array<std::array<uint8_t, OUT>*, Lanes>& out)
+    {
+        constexpr size_t steps = IN / 2;
+
+        llr_.resize(IN);
+        history_.resize(steps);
+
+        // Transpose the frames into lanes.
+        static const std::array<int8_t, IN> erased{};
+        std::array<const int8_t*, Lanes> src;
+        for (size_t lane = 0; lane != Lanes; ++lane)
+        {
+            src[lane] = in[lane] ? in[lane]->data() : erased.data();
+        }
+        for (size_t i = 0; i != IN; ++i)
+        {
+            for (size_t lane = 0; lane != Lanes; ++lane) llr_[i][lane] = src[lane][i];
+        }
+
+        for (auto& m : metrics_) m.fill(METRIC16_INIT);
+        metrics_[0].fill(0);      // Starting point.
+        offset_.fill(0);
+
+        forward(steps);
+
+        std::array<size_t, Lanes> cost{};
+        std::array<uint8_t, Lanes> state{};
+        for (size_t lane = 0; lane != Lanes; ++lane)
+        {
+            size_t min_element = 0;
+            for (size_t i = 0; i != NumStates; ++i)
+            {
+                if (metrics_[i][lane] < metrics_[min_element][lane]) min_element = i;
+            }
+
+            int32_t min_cost = offset_[lane] + metrics_[min_element][lane];
+            cost[lane] = in[lane] ? std::round(min_cost / float(detail::llr_limit<LLR_>())) : 0;
+            state[lane] = min_element;
+        }
+
+        // Do chainback.  Only the first OUT steps produce output.  The lanes
+        // are independent, so stepping them together hides the latency of
+        // each lane's chain of dependent loads.
+        static_assert(OUT <= steps);
+        std::array<uint8_t, OUT> discard;
+        std::array<uint8_t*, Lanes> output;
+        for (size_t lane = 0; lane != Lanes; ++lane)
+        {
+            output[lane] = (in[lane] && out[lane]) ? out[lane]->data() : discard.data();
+        }
+        for (size_t index = steps; index != 0; --index)
+        {
+            const auto& hist = history_[index - 1];
+            for (size_t lane = 0; lane != Lanes; ++lane)
+            {
+                auto v = (hist[state[lane]] >> lane) & 1;
+                if (index <= OUT) output[lane][index - 1] = state[lane] & 1;
+                state[lane] = (state[lane] >> 1) | (v << (Trellis_::K - 1));  // viterbi_.prevState_
+            }
+        }
+
+        return cost;
+    }
+
+    void forward(size_t steps)
+    {
+#if defined(OPV_SIMD_X86)
+        if constexpr (Lanes == 16 && NumStates == 16)
+        {
+            if (simd_ == SimdLevel::AVX2) return forward_avx2(steps);
+        }
+#endif
+        forward_lanes(steps);
+    }
+
+    /**
+     * Portable kernel.  The loops over lanes have no dependencies, so the
+     * compiler can vectorize them, but packing the decision bits is not
+     * vectorized.  It is slower than decoding frames one at a time with
+     * Viterbi's vector kernels and is mainly the reference for the AVX2
+     * kernel.
+     */
+    void forward_lanes(size_t steps)
+    {
+        std::array<lanes_t, 4> x;
+        std::array<lanes_t, NumStates> next;
+        lanes_t d0, d1;
+
+        for (size_t hindex = 0; hindex != steps; ++hindex)
+        {
+            const auto& s0 = llr_[hindex * 2];
+            const auto& s1 = llr_[hindex * 2 + 1];
+
+            // Branch costs for each sign combination of the two outputs.
+            // Erased (0) inputs contribute no cost.
+            for (size_t lane = 0; lane != Lanes; ++lane)
+            {
+                int16_t a = s0[lane];
+                int16_t b = s1[lane];
+                int16_t ap = a ? std::abs(limit_ - a) : 0;
+                int16_t am = a ? std::abs(limit_ + a) : 0;
+                int16_t bp = b ? std::abs(limit_ - b) : 0;
+                int16_t bm = b ? std::abs(limit_ + b) : 0;
+                x[0][lane] = am + bm;
+                x[1][lane] = am + bp;
+                x[2][lane] = ap + bm;
+                x[3][lane] = ap + bp;
+            }
+
+            auto& hist = history_[hindex];
+            for (size_t j = 0; j != NumStates / 2; ++j)
+            {
+                const auto& c0 = x[branch_[j]];
+                const auto& c1 = x[3 - branch_[j]];
+                const auto& p0 = metrics_[j];
+                const auto& p1 = metrics_[j + NumStates / 2];
+                const size_t i0 = 2 * j;    // viterbi_.nextState_[j]
+                const size_t i1 = 2 * j + 1;
+
+                for (size_t lane = 0; lane != Lanes; ++lane)
+                {
+                    int16_t m0 = p0[lane] + c0[lane];
+                    int16_t m1 = p0[lane] + c1[lane];
+                    int16_t m2 = p1[lane] + c1[lane];
+                    int16_t m3 = p1[lane] + c0[lane];
+                    d0[lane] = m0 > m2;
+                    d1[lane] = m1 > m3;
+                    next[i0][lane] = std::min(m0, m2);
+                    next[i1][lane] = std::min(m1, m3);
+                }
+
+                lane_mask_t w0 = 0, w1 = 0;
+                for (size_t lane = 0; lane != Lanes; ++lane)
+                {
+                    w0 |= lane_mask_t(d0[lane]) << lane;
+                    w1 |= lane_mask_t(d1[lane]) << lane;
+                }
+                hist[i0] = w0;
+                hist[i1] = w1;
+            }
+            metrics_ = next;
+
+            if (hindex % RENORM_INTERVAL == RENORM_INTERVAL - 1) renormalize();
+        }
+    }
+
+    void renormalize()
+    {
+        lanes_t minimum = metrics_[0];
+        for (size_t i = 1; i != NumStates; ++i)
+        {
+            for (size_t lane = 0; lane != Lanes; ++lane)
+            {
+                minimum[lane] = std::min(minimum[lane], metrics_[i][lane]);
+            }
+        }
+        for (auto& m : metrics_)
+        {
+            for (size_t lane = 0; lane != Lanes; ++lane) m[lane] -= minimum[lane];
+        }
+        for (size_t lane = 0; lane != Lanes; ++lane) offset_[lane] += minimum[lane];
+    }
+
+#if defined(OPV_SIMD_X86)
+    /**
+     * AVX2 kernel for 16 lanes.  Each state's metric is one register.
+     */
+    OPV_TARGET_AVX2
+    void forward_avx2(size_t steps)
+    {
+        static_assert(Lanes == 16 && NumStates == 16);
+
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i limit = _mm256_set1_epi16(limit_);
+
+        __m256i p[NumStates];
+        for (size_t i = 0; i != NumStates; ++i)
+        {
+            p[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(metrics_[i].data()));
+        }
+
+        for (size_t hindex = 0; hindex != steps; ++hindex)
+        {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(llr_[hindex * 2].data()));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(llr_[hindex * 2 + 1].data()));
+            __m256i ea = _mm256_cmpeq_epi16(a, zero);
+            __m256i eb = _mm256_cmpeq_epi16(b, zero);
+
+            __m256i ap = _mm256_andnot_si256(ea, _mm256_abs_epi16(_mm256_sub_epi16(limit, a)));
+            __m256i am = _mm256_andnot_si256(ea, _mm256_abs_epi16(_mm256_add_epi16(limit, a)));
+            __m256i bp = _mm256_andnot_si256(eb, _mm256_abs_epi16(_mm256_sub_epi16(limit, b)));
+            __m256i bm = _mm256_andnot_si256(eb, _mm256_abs_epi16(_mm256_add_epi16(limit, b)));
+
+            const __m256i x[4] = {
+                _mm256_add_epi16(am, bm), _mm256_add_epi16(am, bp),
+                _mm256_add_epi16(ap, bm), _mm256_add_epi16(ap, bp)};
+
+            __m256i next[NumStates];
+            auto& hist = history_[hindex];
+            for (size_t j = 0; j != NumStates / 2; ++j)
+            {
+                __m256i c0 = x[branch_[j]];
+                __m256i c1 = x[3 - branch_[j]];
+                __m256i m0 = _mm256_adds_epi16(p[j], c0);
+                __m256i m1 = _mm256_adds_epi16(p[j], c1);
+                __m256i m2 = _mm256_adds_epi16(p[j + NumStates / 2], c1);
+                __m256i m3 = _mm256_adds_epi16(p[j + NumStates / 2], c0);
+
+                __m256i d0 = _mm256_cmpgt_epi16(m0, m2);
+                __m256i d1 = _mm256_cmpgt_epi16(m1, m3);
+
+                // packs gives [d0 0..7, d1 0..7 | d0 8..15, d1 8..15] as bytes.
+                uint32_t d = _mm256_movemask_epi8(_mm256_packs_epi16(d0, d1));
+                const size_t i0 = 2 * j;    // viterbi_.nextState_[j]
+                const size_t i1 = 2 * j + 1;
+                hist[i0] = lane_mask_t((d & 0xFF) | ((d >> 8) & 0xFF00));
+                hist[i1] = lane_mask_t(((d >> 8) & 0xFF) | ((d >> 16) & 0xFF00));
+
+                next[i0] = _mm256_min_epi16(m0, m2);
+                next[i1] = _mm256_min_epi16(m1, m3);
+            }
+            std::copy(next, next + NumStates, p);
+
+            if (hindex % RENORM_INTERVAL == RENORM_INTERVAL - 1)
+            {
+                __m256i minimum = p[0];
+                for (size_t i = 1; i != NumStates; ++i) minimum = _mm256_min_epi16(minimum, p[i]);
+                for (auto& m : p) m = _mm256_sub_epi16(m, minimum);
+
+                alignas(32) lanes_t lanes;
+                _mm256_store_si256(reinterpret_cast<__m256i*>(lanes.data()), minimum);
+                for (size_t lane = 0; lane != Lanes; ++lane) offset_[lane] += lanes[lane];
+            }
+        }
+
+        for (size_t i = 0; i != NumStates; ++i)
+        {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(metrics_[i].data()), p[i]);
+        }
+    }
+#endif
+};
+
+/**
+ * Gathers frames, from any number of channels, into batches for
+ * BatchViterbi.  Frames are copied on submission.  A batch is decoded when
+ * it is full or when flush() is called, and then each frame's callback is
+ * called in submission order.  Callbacks must not submit frames.  It is
+ * not thread safe.
+ */
+template <typename Trellis_, size_t LLR_, size_t IN, size_t OUT, size_t Lanes = 16>
+struct BatchViterbiScheduler
+{
+    using input_t = std::array<int8_t, IN>;
+    using output_t = std::array<uint8_t, OUT>;
+
+    /**
+     * Receives the decoded frame and its path metric.  The output is only
+     * valid during the call.
+     */
+    using callback_t = std::function<void(const output_t&, size_t)>;
+
+    BatchViterbi<Trellis_, LLR_, Lanes> decoder_;
+    std::array<input_t, Lanes> inputs_;
+    std::array<output_t, Lanes> outputs_;
+    std::array<callback_t, Lanes> callbacks_;
+    size_t count_ = 0;
+
+    BatchViterbiScheduler(Trellis_ trellis)
+    : decoder_(trellis)
+    {}
+
+    size_t pending() const { return count_; }
+
+    void submit(const input_t& frame, callback_t callback)
+    {
+        inputs_[count_] = frame;
+        callbacks_[count_] = std::move(callback);
+        if (++count_ == Lanes) flush();
+    }
+
+    /**
+     * Decode the frames submitted so far.
+     */
+    void flush()
+    {
+        if (count_ == 0) return;
+
+        std::array<const input_t*, Lanes> in{};
+        std::array<output_t*, Lanes> out{};
+        for (size_t i = 0; i != count_; ++i)
+        {
+            in[i] = &inputs_[i];
+            out[i] = &outputs_[i];
+        }
+
+        auto cost = decoder_.decode(in, out);
+        for (size_t i = 0; i != count_; ++i)
+        {
+            callbacks_[i](outputs_[i], cost[i]);
+        }
+        count_ = 0;
+    }
+};
+
+} // mobilinkd
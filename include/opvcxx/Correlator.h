@@ -7,12 +7,15 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
 #include <cstddef>
 #include <type_traits>
 #include <tuple>
 #include <limits>
 #include <iostream>
+#include <numeric>
+#include <vector>
 
 extern uint32_t debug_sample_count;
 
@@ -23,18 +26,25 @@ struct Correlator
 {
 	static constexpr size_t SYMBOLS = 8;
 	static constexpr size_t SAMPLES_PER_SYMBOL = 10;
+	static_assert(SYMBOLS == 8, "correlate() sums 8 products");
 
 	using value_type = FloatType;
-    using buffer_t = std::array<FloatType, SYMBOLS * SAMPLES_PER_SYMBOL>;
+    // Samples are kept by timing phase: buffer_[phase] holds the last
+    // SYMBOLS samples of that phase, oldest first from the slot after the
+    // newest.  Each row is stored twice over so that the SYMBOLS samples
+    // ending at any slot are contiguous.
+    using row_t = std::array<FloatType, SYMBOLS * 2>;
+    using buffer_t = std::array<row_t, SAMPLES_PER_SYMBOL>;
     using sync_t = std::array<int8_t, SYMBOLS>;
     using sample_filter_t = BaseIirFilter<FloatType, 3>;
 
-    buffer_t buffer_;
+    buffer_t buffer_{};
 
     FloatType limit_ = 0.;
-    size_t symbol_pos_ = 0;
-    size_t buffer_pos_ = 0;
-    size_t prev_buffer_pos_ = 0;
+    size_t phase_ = 0;          // phase of the next sample
+    size_t slot_ = 0;           // symbol slot of the next sample
+    size_t prev_phase_ = 0;
+    size_t prev_slot_ = 0;
     int code = -1;
 
     // IIR with Nyquist of 1/240.
@@ -54,28 +64,39 @@ struct Correlator
 
 		// std::cerr << "@ " << debug_sample_count << " filtered_sample = " << value << " limit = " << limit_ << std::endl;	//!!!debug
 
-        buffer_[buffer_pos_] = value;
-        prev_buffer_pos_ = buffer_pos_;
-        if (++buffer_pos_ == buffer_.size()) buffer_pos_ = 0;
+        store(value);
     }
 
     FloatType correlate(sync_t sync)
     {
-        FloatType result = 0.;
-        size_t pos = prev_buffer_pos_ + SAMPLES_PER_SYMBOL;
+        return correlate(std::array<sync_t, 1>{sync})[0];
+    }
+
+    /**
+     * Correlate several sync words against the newest sample and the
+     * samples a symbol apart before it, in one pass over the buffer.
+     */
+    template <size_t M>
+    std::array<FloatType, M> correlate(const std::array<sync_t, M>& sync) const
+    {
+        const FloatType* samples = buffer_[prev_phase_].data() + prev_slot_ + 1;
 
-        for (size_t i = 0; i != sync.size(); ++i)
+        std::array<FloatType, M> result{};
+        for (size_t m = 0; m != M; ++m)
         {
-            if (pos >= buffer_.size())
-                pos -= buffer_.size(); // wrapped
-            result += sync[i] * buffer_[pos];
-            pos += SAMPLES_PER_SYMBOL;
+            // Oldest sample first, so that the sums are the same as when
+            // each word was correlated separately.
+            for (size_t i = 0; i != SYMBOLS; ++i)
+            {
+                result[m] += sync[m][i] * samples[i];
+            }
         }
         return result;
     }
 
     FloatType limit() const {return limit_;}
-    size_t index() const {return prev_buffer_pos_ % SAMPLES_PER_SYMBOL;}
+    size_t index() const {return prev_phase_;}
+    size_t next_index() const {return phase_;}
 
     /**
      * Get the average outer symbol levels at a given index.  This makes three
@@ -95,14 +116,14 @@ struct Correlator
         FloatType max_sum = 0;
         size_t min_count = 0;
         size_t max_count = 0;
-        size_t index = 0;
-        for (size_t i = sample_index; i < buffer_.size(); i += SAMPLES_PER_SYMBOL)
+        const auto& row = buffer_[sample_index];
+        for (size_t i = 0; i != SYMBOLS; ++i)
         {
-            tmp[index++] = buffer_[i] * 1000.;
-            max_sum += buffer_[i] * ((buffer_[i] > 0.));
-            min_sum += buffer_[i] * ((buffer_[i] < 0.));
-            max_count += (buffer_[i] > 0.);
-            min_count += (buffer_[i] < 0.);
+            tmp[i] = row[i] * 1000.;
+            max_sum += row[i] * ((row[i] > 0.));
+            min_sum += row[i] * ((row[i] < 0.));
+            max_count += (row[i] > 0.);
+            min_count += (row[i] < 0.);
         }
 
         return std::make_tuple(min_sum / min_count, max_sum / max_count);
@@ -112,11 +133,27 @@ struct Correlator
     template <typename F>
     void apply(F func, uint8_t index)
     {
-    	for (size_t i = index; i < buffer_.size(); i += SAMPLES_PER_SYMBOL)
+    	const auto& row = buffer_[index];
+    	for (size_t i = 0; i != SYMBOLS; ++i)
     	{
-    		func(buffer_[i]);
+    		func(row[i]);
     	}
     }
+
+private:
+
+    void store(FloatType value)
+    {
+        buffer_[phase_][slot_] = value;
+        buffer_[phase_][slot_ + SYMBOLS] = value;
+        prev_phase_ = phase_;
+        prev_slot_ = slot_;
+        if (++phase_ == SAMPLES_PER_SYMBOL)
+        {
+            phase_ = 0;
+            if (++slot_ == SYMBOLS) slot_ = 0;
+        }
+    }
 };
 
 template <typename Correlator>
@@ -143,10 +180,18 @@ struct SyncWord
 	{}
 
 	value_type triggered(Correlator& correlator)
+	{
+		return triggered(correlator, correlator.correlate(sync_word_));
+	}
+
+	/**
+	 * As above, with the correlation already computed, e.g. along with
+	 * other sync words by Correlator::correlate().
+	 */
+	value_type triggered(Correlator& correlator, value_type value)
 	{
 		value_type limit_1 = correlator.limit() * magnitude_1_;
 		value_type limit_2 = correlator.limit() * magnitude_2_;
-		auto value = correlator.correlate(sync_word_);
 
 		// std::cerr << "@ " << debug_sample_count << " triggered() value = " << value << " limit1 limit2 = " << limit_1 << " " << limit_2 << std::endl;
 
@@ -200,4 +245,194 @@ struct SyncWord
 	}
 };
 
+/**
+ * Search a whole buffer of matched filter output for sync words, for
+ * offline decoding of recordings.  It lists where the preamble and the
+ * STREAM sync word start, with their timing phase, without running the
+ * demodulator state machine.
+ *
+ * A sync word is only 8 taps spaced a symbol apart, so the correlations
+ * are computed directly for every offset, all WORDS of them in one
+ * vectorized pass.  The trigger level is the mean magnitude of the
+ * preceding LIMIT_WINDOW samples times the magnitude of the pattern.
+ * That is not the low pass filtered limit of the Correlator, so a peak
+ * close to the trigger level may be found by one and not the other.
+ */
+template <typename FloatType, size_t WORDS = 1>
+struct SyncSearch
+{
+    static constexpr size_t SYMBOLS = 8;
+    static constexpr size_t SAMPLES_PER_SYMBOL = 10;
+    static constexpr size_t SPAN = (SYMBOLS - 1) * SAMPLES_PER_SYMBOL;
+    static constexpr size_t LIMIT_WINDOW = 640;
+    static constexpr size_t BLOCK_SIZE = 400 * SAMPLES_PER_SYMBOL;
+
+    using sync_t = std::array<int8_t, SYMBOLS>;
+
+    struct Pattern
+    {
+        sync_t sync_word;
+        FloatType magnitude_1;
+        FloatType magnitude_2 = std::numeric_limits<FloatType>::lowest();
+    };
+
+    struct Candidate
+    {
+        size_t offset;      // sample of the first symbol of the sync word
+        FloatType value;    // correlation at the peak
+        size_t word = 0;    // index of the pattern found
+
+        // The symbol timing phase, as Correlator::index().
+        size_t phase() const { return offset % SAMPLES_PER_SYMBOL; }
+    };
+
+    std::array<Pattern, WORDS> patterns_;
+    std::array<std::array<FloatType, BLOCK_SIZE>, WORDS> correlation_;
+
+    SyncSearch(const std::array<Pattern, WORDS>& patterns)
+    : patterns_(patterns)
+    {}
+
+    SyncSearch(sync_t sync_word, FloatType magnitude_1, FloatType magnitude_2 = std::numeric_limits<FloatType>::lowest())
+    requires (WORDS == 1)
+    : patterns_{{{sync_word, magnitude_1, magnitude_2}}}
+    {}
+
+    /**
+     * Correlate each sync word at every offset.  Each of @p out receives
+     * count - SPAN values; out[w][k] is the correlation of sync word w
+     * starting at input[k].
+     */
+    void correlate(const FloatType* input, size_t count, const std::array<FloatType*, WORDS>& out) const
+    {
+        if (count <= SPAN) return;
+        const size_t n = count - SPAN;
+
+        std::array<std::array<FloatType, SYMBOLS>, WORDS> sync;
+        for (size_t w = 0; w != WORDS; ++w)
+        {
+            for (size_t i = 0; i != SYMBOLS; ++i) sync[w][i] = patterns_[w].sync_word[i];
+        }
+
+        for (size_t k = 0; k != n; ++k)
+        {
+            for (size_t w = 0; w != WORDS; ++w)
+            {
+                FloatType result = 0;
+                for (size_t i = 0; i != SYMBOLS; ++i)
+                {
+                    result += sync[w][i] * input[k + i * SAMPLES_PER_SYMBOL];
+                }
+                out[w][k] = result;
+            }
+        }
+    }
+
+    void correlate(const FloatType* input, size_t count, FloatType* out) const
+    requires (WORDS == 1)
+    {
+        correlate(input, count, std::array<FloatType*, 1>{out});
+    }
+
+    /**
+     * Find the sync words in @p input.  Each run of offsets where the
+     * correlation of a word is past its trigger level gives one candidate,
+     * at its peak.  Candidates are in order of offset.
+     */
+    std::vector<Candidate> operator()(const FloatType* input, size_t count)
+    {
+        std::vector<Candidate> result;
+        if (count <= SPAN) return result;
+
+        const size_t n = count - SPAN;
+
+        // Sums of magnitudes in the limit window, by sample phase.  They
+        // are updated a symbol at a time without a serial dependency.
+        std::array<double, SAMPLES_PER_SYMBOL> sum{};
+        size_t window_end = 0;
+        std::array<bool, WORDS> triggered{};
+        std::array<Candidate, WORDS> peak{};
+
+        std::array<FloatType*, WORDS> out;
+        for (size_t w = 0; w != WORDS; ++w) out[w] = correlation_[w].data();
+
+        // Correlate a cache sized block at a time.
+        for (size_t start = 0; start < n; start += BLOCK_SIZE)
+        {
+            const size_t block = std::min(BLOCK_SIZE, n - start);
+            correlate(input + start, block + SPAN, out);
+
+            // The limit is updated once per symbol, with the window ending
+            // at the newest sample of the last sync word of the symbol.
+            for (size_t j = 0; j < block; j += SAMPLES_PER_SYMBOL)
+            {
+                const size_t end = std::min(j + SAMPLES_PER_SYMBOL, block);
+                const size_t newest = start + end + SPAN;
+                if (window_end >= LIMIT_WINDOW && newest == window_end + SAMPLES_PER_SYMBOL)
+                {
+                    for (size_t i = 0; i != SAMPLES_PER_SYMBOL; ++i)
+                    {
+                        sum[(window_end + i) % SAMPLES_PER_SYMBOL] += std::abs(input[window_end + i]) - std::abs(input[window_end + i - LIMIT_WINDOW]);
+                    }
+                    window_end = newest;
+                }
+                for (; window_end != newest; ++window_end)
+                {
+                    const FloatType oldest = window_end >= LIMIT_WINDOW ? std::abs(input[window_end - LIMIT_WINDOW]) : 0;
+                    sum[window_end % SAMPLES_PER_SYMBOL] += std::abs(input[window_end]) - oldest;
+                }
+                const FloatType limit = std::accumulate(sum.begin(), sum.end(), 0.0) / std::min(window_end, LIMIT_WINDOW);
+
+                for (size_t w = 0; w != WORDS; ++w)
+                {
+                    const FloatType limit_1 = limit * patterns_[w].magnitude_1;
+                    const FloatType limit_2 = limit * patterns_[w].magnitude_2;
+                    const auto& correlation = correlation_[w];
+
+                    // Most symbols have nothing near the limit.
+                    if (!triggered[w] && end == j + SAMPLES_PER_SYMBOL)
+                    {
+                        const FloatType* c = correlation.data() + j;
+                        FloatType high = c[0];
+                        FloatType low = c[0];
+                        for (size_t k = 1; k != SAMPLES_PER_SYMBOL; ++k)
+                        {
+                            high = std::max(high, c[k]);
+                            low = std::min(low, c[k]);
+                        }
+                        if (high <= limit_1 && low >= limit_2) continue;
+                    }
+
+                    for (size_t k = j; k != end; ++k)
+                    {
+                        const FloatType value = correlation[k];
+                        if (value > limit_1 || value < limit_2)
+                        {
+                            if (!triggered[w] || std::abs(value) > std::abs(peak[w].value)) peak[w] = {start + k, value, w};
+                            triggered[w] = true;
+                        }
+                        else if (triggered[w])
+                        {
+                            result.push_back(peak[w]);
+                            triggered[w] = false;
+                        }
+                    }
+                }
+            }
+        }
+        for (size_t w = 0; w != WORDS; ++w)
+        {
+            if (triggered[w]) result.push_back(peak[w]);
+        }
+
+        if constexpr (WORDS > 1)
+        {
+            std::stable_sort(result.begin(), result.end(),
+                [](const Candidate& a, const Candidate& b) { return a.offset < b.offset; });
+        }
+
+        return result;
+    }
+};
+
 } // mobilinkd
@@ -4,9 +4,12 @@
 
 #include "SlidingDFT.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <complex>
 #include <cstddef>
+#include <cstdint>
 
 namespace mobilinkd {
 
@@ -73,4 +76,245 @@ struct DataCarrierDetect
     bool dcd() const { return triggered_; }
 };
 
+/**
+ * DataCarrierDetect for block input.  Instead of updating both sliding
+ * DFTs on every sample and summing their power at every sample, the input
+ * is split into sub-blocks of a quarter of the DFT length.  The DFT of each
+ * sub-block is computed at the two frequencies, and the power of the last
+ * four together, an N sample window, is summed once per sub-block.  The
+ * windows overlap as those of the sliding DFT do, only with a larger step,
+ * so the level has about the same variance and the trigger thresholds
+ * give the same decisions.  (Disjoint N sample blocks give a level biased
+ * upwards over the few blocks between updates, which holds the carrier
+ * too long.)  Each sample costs four multiply-adds against precomputed
+ * sine and cosine tables, and a sub-block is a loop that the compiler can
+ * vectorize.  Samples from a partial sub-block carry over to the next
+ * update().
+ */
+template <typename FloatType, size_t SampleRate, size_t Accuracy = 1000>
+struct BlockDataCarrierDetect
+{
+    static constexpr size_t N = SampleRate / Accuracy;
+    static constexpr size_t SUBBLOCKS = N % 4 == 0 ? 4 : N % 2 == 0 ? 2 : 1;
+    static constexpr size_t STEP = N / SUBBLOCKS;
+    static constexpr size_t LANES = 8;
+
+    using table_t = std::array<FloatType, N>;
+    using dft_t = std::array<FloatType, 4>;    // re1, im1, re2, im2
+
+    table_t cos1_, sin1_, cos2_, sin2_;
+    dft_t dft_{};                               // the current sub-block
+    std::array<dft_t, SUBBLOCKS> history_{};    // the last complete sub-blocks
+    size_t pos_ = 0;        // position in the DFT, for the tables
+    size_t count_ = 0;      // samples in the current sub-block
+    size_t next_ = 0;       // oldest entry of history_
+    FloatType ltrigger_;
+    FloatType htrigger_;
+    FloatType level_1 = 0.0;
+    FloatType level_2 = 0.0;
+    FloatType level_ = 0.0;
+    bool triggered_ = false;
+
+    BlockDataCarrierDetect(
+        size_t freq1, size_t freq2,
+        FloatType ltrigger = 2.0, FloatType htrigger = 5.0)
+    : ltrigger_(ltrigger), htrigger_(htrigger)
+    {
+        for (size_t i = 0; i != N; ++i)
+        {
+            double w1 = 2.0 * M_PI * freq1 * i / SampleRate;
+            double w2 = 2.0 * M_PI * freq2 * i / SampleRate;
+            cos1_[i] = std::cos(w1);
+            sin1_[i] = std::sin(w1);
+            cos2_[i] = std::cos(w2);
+            sin2_[i] = std::sin(w2);
+        }
+    }
+
+    void operator()(FloatType sample)
+    {
+        (*this)(&sample, 1);
+    }
+
+    /**
+     * Accept @p count samples of unfiltered baseband input.
+     */
+    void operator()(const FloatType* samples, size_t count)
+    {
+        while (count != 0)
+        {
+            const size_t n = std::min(count, STEP - count_);
+            accumulate(samples, n);
+            samples += n;
+            count -= n;
+            count_ += n;
+            pos_ += n;
+            if (pos_ == N) pos_ = 0;
+
+            if (count_ == STEP)
+            {
+                // The tables are in phase across sub-blocks, so the DFT of
+                // the window is the sum of its sub-blocks'.  STEP times its
+                // power matches the per-sample sum.
+                history_[next_] = dft_;
+                if (++next_ == SUBBLOCKS) next_ = 0;
+                dft_t window{};
+                for (const auto& d : history_)
+                {
+                    for (size_t j = 0; j != 4; ++j) window[j] += d[j];
+                }
+                level_1 += (window[0] * window[0] + window[1] * window[1]) * FloatType(STEP);
+                level_2 += (window[2] * window[2] + window[3] * window[3]) * FloatType(STEP);
+                dft_.fill(0);
+                count_ = 0;
+            }
+        }
+    }
+
+    /**
+     * Update the data carrier detection level from the sub-blocks
+     * completed since the last update.
+     */
+    void update()
+    {
+        if (level_2 == 0) return;   // no complete sub-block since the last update, or silence
+        level_ = level_ * FloatType(0.8) + FloatType(0.2) * (level_1 / level_2);
+        level_1 = 0.0;
+        level_2 = 0.0;
+        triggered_ = triggered_ ? level_ > ltrigger_ : level_ > htrigger_;
+    }
+
+    FloatType level() const { return level_; }
+    bool dcd() const { return triggered_; }
+
+private:
+
+    // Independent partial sums for each lane so that the loop vectorizes
+    // without reassociating the additions.
+    void accumulate(const FloatType* x, size_t n)
+    {
+        FloatType acc[4][LANES] = {};
+        const FloatType* c1 = cos1_.data() + pos_;
+        const FloatType* s1 = sin1_.data() + pos_;
+        const FloatType* c2 = cos2_.data() + pos_;
+        const FloatType* s2 = sin2_.data() + pos_;
+
+        size_t i = 0;
+        for (; i + LANES <= n; i += LANES)
+        {
+            for (size_t k = 0; k != LANES; ++k)
+            {
+                acc[0][k] += x[i + k] * c1[i + k];
+                acc[1][k] += x[i + k] * s1[i + k];
+                acc[2][k] += x[i + k] * c2[i + k];
+                acc[3][k] += x[i + k] * s2[i + k];
+            }
+        }
+        for (; i != n; ++i)
+        {
+            acc[0][0] += x[i] * c1[i];
+            acc[1][0] += x[i] * s1[i];
+            acc[2][0] += x[i] * c2[i];
+            acc[3][0] += x[i] * s2[i];
+        }
+
+        for (size_t j = 0; j != 4; ++j)
+        {
+            for (size_t k = 0; k != LANES; ++k) dft_[j] += acc[j][k];
+        }
+    }
+};
+
+/**
+ * A cheap idle channel test to run in front of a DataCarrierDetect.  It
+ * counts changes of the sign bit, about one operation per sample.  On an
+ * idle channel the baseband is broadband noise, which changes sign on
+ * about half of the samples.  A 4-FSK signal is band limited to the
+ * symbol rate, so once it is strong enough to be decoded it lowers the
+ * zero crossing rate.
+ *
+ * Raw int16 samples and scaled floating point samples give the same
+ * count, even for a negative scale, since 0 * -scale is -0.0.
+ *
+ * update() is called once per interval and reports whether the interval
+ * looked idle: its rate was above @p wake times the idle rate.  The idle
+ * rate follows the measured rate of idle intervals slowly, so it adapts to
+ * the noise spectrum of the receiver but not to a weak signal.
+ */
+template <typename FloatType>
+struct ZeroCrossingSquelch
+{
+    FloatType wake_;
+    FloatType idle_rate_ = 0.5;
+    size_t crossings_ = 0;
+    size_t count_ = 0;
+    bool negative_ = false;     // sign bit of the last sample
+    bool primed_ = false;       // negative_ has been set by a sample
+
+    ZeroCrossingSquelch(FloatType wake = 0.85)
+    : wake_(wake)
+    {}
+
+    void operator()(const int16_t* samples, size_t count)
+    {
+        if (count == 0) return;
+
+        if (!primed_) negative_ = samples[0] < 0;
+        primed_ = true;
+
+        // 16-bit partial counts so that the loop vectorizes.
+        size_t crossings = (samples[0] < 0) != negative_;
+        for (size_t i = 1; i < count; i += 32768)
+        {
+            const size_t end = std::min(count, i + 32768);
+            uint16_t partial = 0;
+            for (size_t j = i; j != end; ++j)
+            {
+                partial += uint16_t(samples[j] ^ samples[j - 1]) >> 15;
+            }
+            crossings += partial;
+        }
+        negative_ = samples[count - 1] < 0;
+        crossings_ += crossings;
+        count_ += count;
+    }
+
+    void operator()(const FloatType* samples, size_t count)
+    {
+        if (count == 0) return;
+
+        if (!primed_) negative_ = std::signbit(samples[0]);
+        primed_ = true;
+
+        for (size_t i = 0; i != count; ++i)
+        {
+            bool negative = std::signbit(samples[i]);
+            crossings_ += negative != negative_;
+            negative_ = negative;
+        }
+        count_ += count;
+    }
+
+    /**
+     * End the interval.  Returns true if it looked idle.
+     *
+     * @param noise is true if the caller knows that the interval had no
+     *  signal, e.g. from the DCD.  The idle rate then follows it even if
+     *  it did not look idle, in case the noise floor changed.
+     */
+    bool update(bool noise = false)
+    {
+        if (count_ == 0) return true;
+
+        FloatType rate = FloatType(crossings_) / count_;
+        bool idle = rate > idle_rate_ * wake_;
+        if (idle || noise) idle_rate_ += (rate - idle_rate_) * FloatType(1.0 / 16);
+        crossings_ = 0;
+        count_ = 0;
+        return idle;
+    }
+
+    FloatType idle_rate() const { return idle_rate_; }
+};
+
 } // mobilinkd
@@ -3,9 +3,14 @@
 #pragma once
 
 #include "Filter.h"
+#include "Simd.h"
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 
 namespace mobilinkd
 {
@@ -49,6 +54,448 @@ struct BaseFirFilter : FilterBase<FloatType>
 	}
 };
 
+namespace detail
+{
+
+// Partial sums per dot product: four 256-bit or eight 128-bit registers.
+template <typename FloatType>
+constexpr size_t fir_lanes = 128 / sizeof(FloatType);
+
+// Dot product of two length N arrays, N a multiple of fir_lanes.  The
+// independent partial sums let the compiler keep them in vector registers
+// and hide the latency of the additions; a single running sum cannot be
+// vectorized without reassociating the additions.
+template <typename FloatType, size_t N>
+inline FloatType fir_dot(const FloatType* x, const FloatType* h)
+{
+	constexpr size_t LANES = fir_lanes<FloatType>;
+	static_assert(N % LANES == 0);
+
+	FloatType acc[LANES] = {};
+	for (size_t i = 0; i != N; i += LANES)
+	{
+		for (size_t k = 0; k != LANES; ++k)
+		{
+			acc[k] += x[i + k] * h[i + k];
+		}
+	}
+
+	for (size_t k = LANES / 2; k != 0; k /= 2)
+	{
+		for (size_t j = 0; j != k; ++j)
+		{
+			acc[j] += acc[j + k];
+		}
+	}
+	return acc[0];
+}
+
+} // detail
+
+/**
+ * FIR filter without the virtual call and circular indexing of
+ * BaseFirFilter.  The taps are reversed and zero-padded at the front to a
+ * multiple of the dot product width.  Each input is stored twice, TAPS
+ * samples apart, so the last TAPS inputs are always contiguous and the
+ * output is one dot product.  The block operator() filters a buffer of
+ * samples from a linear copy of the history and gives the same results
+ * as filtering one sample at a time.  On x86 it uses AVX2 when the CPU
+ * has it.
+ */
+template <typename FloatType, size_t N>
+struct FirFilter
+{
+	using array_t = std::array<FloatType, N>;
+
+	static constexpr size_t LANES = detail::fir_lanes<FloatType>;
+	static constexpr size_t TAPS = (N + LANES - 1) / LANES * LANES;
+	static constexpr size_t BLOCK_SIZE = 256;
+
+	alignas(32) std::array<FloatType, TAPS> taps_;		// reversed: oldest sample first
+	alignas(32) std::array<FloatType, TAPS * 2> history_;
+	alignas(32) std::array<FloatType, TAPS - 1 + BLOCK_SIZE> block_;
+	size_t pos_ = 0;
+
+	FirFilter(const array_t& taps)
+	{
+		taps_.fill(0.0);
+		std::reverse_copy(taps.begin(), taps.end(), taps_.end() - N);
+		reset();
+	}
+
+	FloatType operator()(FloatType input)
+	{
+		push(input);
+
+		const FloatType* window = history_.data() + pos_;
+#if defined(OPV_SIMD_X86)
+		if (simd_level() == SimdLevel::AVX2) return dot_avx2(window);
+#endif
+		return detail::fir_dot<FloatType, TAPS>(window, taps_.data());
+	}
+
+	/**
+	 * Filter @p count samples from @p input into @p output.  The buffers
+	 * may be the same.
+	 */
+	void operator()(const FloatType* input, FloatType* output, size_t count)
+	{
+		while (count != 0)
+		{
+			const size_t n = std::min(count, BLOCK_SIZE);
+
+			// The last TAPS - 1 inputs, oldest first, then the new inputs.
+			std::copy_n(history_.data() + pos_ + 1, TAPS - 1, block_.data());
+			std::copy_n(input, n, block_.data() + TAPS - 1);
+
+			filter_block(block_.data(), output, n);
+
+			for (size_t i = 0; i != n; ++i)
+			{
+				push(block_[TAPS - 1 + i]);
+			}
+
+			input += n;
+			output += n;
+			count -= n;
+		}
+	}
+
+	void reset()
+	{
+		history_.fill(0.0);
+		pos_ = 0;
+	}
+
+private:
+
+	void filter_block(const FloatType* block, FloatType* output, size_t n) const
+	{
+#if defined(OPV_SIMD_X86)
+		if (simd_level() == SimdLevel::AVX2)
+		{
+			filter_block_avx2(block, output, n);
+			return;
+		}
+#endif
+		for (size_t i = 0; i != n; ++i)
+		{
+			output[i] = detail::fir_dot<FloatType, TAPS>(block + i, taps_.data());
+		}
+	}
+
+#if defined(OPV_SIMD_X86)
+	// The same code compiled for AVX2, which doubles the vector width.
+	// Without FMA the results are identical to the generic code.
+	OPV_TARGET_AVX2
+	FloatType dot_avx2(const FloatType* window) const
+	{
+		return detail::fir_dot<FloatType, TAPS>(window, taps_.data());
+	}
+
+	OPV_TARGET_AVX2
+	void filter_block_avx2(const FloatType* block, FloatType* output, size_t n) const
+	{
+		for (size_t i = 0; i != n; ++i)
+		{
+			output[i] = detail::fir_dot<FloatType, TAPS>(block + i, taps_.data());
+		}
+	}
+#endif
+
+	void push(FloatType input)
+	{
+		history_[pos_] = input;
+		history_[pos_ + TAPS] = input;
+		if (++pos_ == TAPS) pos_ = 0;
+	}
+};
+
+/**
+ * FirFilter for raw int16 samples using int16 taps and int32 accumulators.
+ * The taps are scaled by 2^shift(), as large as the taps allow without
+ * any sum of products overflowing int32 for full scale input, so the
+ * outputs are the filtered samples times 2^shift().  Integer sums do not
+ * depend on the order of the additions, so the output is the same at
+ * every SIMD level.
+ */
+template <size_t N>
+struct FixedPointFirFilter
+{
+	static constexpr size_t LANES = 16;
+	static constexpr size_t TAPS = (N + LANES - 1) / LANES * LANES;
+	static constexpr size_t BLOCK_SIZE = 256;
+
+	alignas(32) std::array<int16_t, TAPS> taps_;		// reversed: oldest sample first
+	alignas(32) std::array<int16_t, TAPS * 2> history_;
+	alignas(32) std::array<int16_t, TAPS - 1 + BLOCK_SIZE> block_;
+	size_t pos_ = 0;
+	int shift_ = 0;
+
+	template <typename FloatType>
+	FixedPointFirFilter(const std::array<FloatType, N>& taps)
+	{
+		double max_tap = 0.0;
+		double sum = 0.0;
+		for (auto h : taps)
+		{
+			max_tap = std::max(max_tap, std::abs(double(h)));
+			sum += std::abs(double(h));
+		}
+
+		// Each tap rounds up by at most 0.5.
+		while (shift_ != 15
+			&& max_tap * (1 << (shift_ + 1)) < 32767.0
+			&& (sum * (1 << (shift_ + 1)) + N * 0.5) * 32768.0 < 2147483647.0)
+		{
+			++shift_;
+		}
+
+		taps_.fill(0);
+		for (size_t i = 0; i != N; ++i)
+		{
+			taps_[TAPS - 1 - i] = std::lround(taps[i] * (1 << shift_));
+		}
+		reset();
+	}
+
+	int shift() const { return shift_; }
+
+	int32_t operator()(int16_t input)
+	{
+		push(input);
+		return output();
+	}
+
+	void push(int16_t input)
+	{
+		history_[pos_] = input;
+		history_[pos_ + TAPS] = input;
+		if (++pos_ == TAPS) pos_ = 0;
+	}
+
+	int32_t output() const
+	{
+		const int16_t* window = history_.data() + pos_;
+#if defined(OPV_SIMD_X86)
+		if (simd_level() == SimdLevel::AVX2) return dot_avx2(window);
+#endif
+		return dot(window, taps_.data());
+	}
+
+	/**
+	 * Filter @p count samples from @p input into @p output.
+	 */
+	void operator()(const int16_t* input, int32_t* output, size_t count)
+	{
+		while (count != 0)
+		{
+			const size_t n = std::min(count, BLOCK_SIZE);
+
+			std::copy_n(history_.data() + pos_ + 1, TAPS - 1, block_.data());
+			std::copy_n(input, n, block_.data() + TAPS - 1);
+
+			filter_block(block_.data(), output, n);
+
+			for (size_t i = 0; i != n; ++i)
+			{
+				push(block_[TAPS - 1 + i]);
+			}
+
+			input += n;
+			output += n;
+			count -= n;
+		}
+	}
+
+	void reset()
+	{
+		history_.fill(0);
+		pos_ = 0;
+	}
+
+private:
+
+	static int32_t dot(const int16_t* x, const int16_t* h)
+	{
+		int32_t result = 0;
+		for (size_t i = 0; i != TAPS; ++i)
+		{
+			result += int32_t(x[i]) * h[i];
+		}
+		return result;
+	}
+
+	void filter_block(const int16_t* block, int32_t* output, size_t n) const
+	{
+#if defined(OPV_SIMD_X86)
+		if (simd_level() == SimdLevel::AVX2)
+		{
+			filter_block_avx2(block, output, n);
+			return;
+		}
+#endif
+		for (size_t i = 0; i != n; ++i)
+		{
+			output[i] = dot(block + i, taps_.data());
+		}
+	}
+
+#if defined(OPV_SIMD_X86)
+	// vpmaddwd does 16 multiplies and 8 of the additions.
+	OPV_TARGET_AVX2
+	int32_t dot_avx2(const int16_t* window) const
+	{
+		__m256i acc = _mm256_setzero_si256();
+		for (size_t i = 0; i != TAPS; i += 16)
+		{
+			__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(window + i));
+			__m256i h = _mm256_load_si256(reinterpret_cast<const __m256i*>(taps_.data() + i));
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, h));
+		}
+		__m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+		return _mm_cvtsi128_si32(sum);
+	}
+
+	OPV_TARGET_AVX2
+	void filter_block_avx2(const int16_t* block, int32_t* output, size_t n) const
+	{
+		for (size_t i = 0; i != n; ++i)
+		{
+			output[i] = dot_avx2(block + i);
+		}
+	}
+#endif
+};
+
+/**
+ * Interpolate by L with an N tap FIR filter, N a multiple of L.  This is
+ * the same as inserting L - 1 zeros after each input and filtering the
+ * result with BaseFirFilter, but only the taps that line up with a real
+ * input are used: output p of each input is the dot product of sub-filter
+ * p (taps p, p + L, p + 2L, ...) with the last N / L inputs.  The terms
+ * are added in the same order as BaseFirFilter adds them, so the outputs
+ * are identical.
+ */
+template <typename FloatType, size_t N, size_t L>
+struct FirInterpolator
+{
+	static_assert(N % L == 0);
+
+	using array_t = std::array<FloatType, N>;
+
+	static constexpr size_t PHASE_TAPS = N / L;
+
+	std::array<std::array<FloatType, L>, PHASE_TAPS> taps_;	// [input][phase]
+	std::array<FloatType, PHASE_TAPS> history_;				// newest first
+
+	FirInterpolator(const array_t& taps)
+	{
+		for (size_t i = 0; i != N; ++i)
+		{
+			taps_[i / L][i % L] = taps[i];
+		}
+		reset();
+	}
+
+	/**
+	 * Add one input and write the L outputs that follow it to @p output.
+	 */
+	void operator()(FloatType input, FloatType* output)
+	{
+		std::copy_backward(history_.begin(), history_.end() - 1, history_.end());
+		history_[0] = input;
+
+		std::array<FloatType, L> result;
+		result.fill(0.0);
+		for (size_t j = 0; j != PHASE_TAPS; ++j)
+		{
+			for (size_t p = 0; p != L; ++p)
+			{
+				result[p] += history_[j] * taps_[j][p];
+			}
+		}
+		std::copy(result.begin(), result.end(), output);
+	}
+
+	void reset()
+	{
+		history_.fill(0.0);
+	}
+};
+
+/**
+ * FirInterpolator for 4-FSK symbols in integer arithmetic.  An input is a
+ * symbol level in [-3, 3], so the contribution of each of the last N / L
+ * symbols to each of the L output phases is looked up in a table of
+ * taps * level * scale, computed once with FRAC_BITS fraction bits.  An
+ * output is the sum of N / L table entries, truncated toward zero like the
+ * conversion of the floating point output to int16.  The rounding of the
+ * table entries adds at most N / L / 2^(FRAC_BITS + 1) LSB, so the
+ * result is within 1 LSB of the floating point one.
+ */
+template <size_t N, size_t L>
+struct FixedPointInterpolator
+{
+	static_assert(N % L == 0);
+
+	static constexpr size_t PHASE_TAPS = N / L;
+	static constexpr int MAX_LEVEL = 3;
+	static constexpr int FRAC_BITS = 8;
+
+	using table_t = std::array<std::array<int32_t, L>, MAX_LEVEL * 2 + 1>;
+
+	std::array<table_t, PHASE_TAPS> table_;			// [input][level + 3][phase]
+	std::array<uint8_t, PHASE_TAPS> history_;		// level + 3, newest first
+
+	template <typename FloatType>
+	FixedPointInterpolator(const std::array<FloatType, N>& taps, double scale)
+	{
+		for (size_t i = 0; i != N; ++i)
+		{
+			for (int level = -MAX_LEVEL; level <= MAX_LEVEL; ++level)
+			{
+				table_[i / L][level + MAX_LEVEL][i % L] =
+					std::lround(taps[i] * level * scale * (1 << FRAC_BITS));
+			}
+		}
+		reset();
+	}
+
+	/**
+	 * Add one symbol and write the L outputs that follow it to @p output.
+	 */
+	void operator()(int8_t symbol, int16_t* output)
+	{
+		assert(symbol >= -MAX_LEVEL && symbol <= MAX_LEVEL);
+
+		std::copy_backward(history_.begin(), history_.end() - 1, history_.end());
+		history_[0] = symbol + MAX_LEVEL;
+
+		std::array<int32_t, L> result;
+		result.fill(0);
+		for (size_t j = 0; j != PHASE_TAPS; ++j)
+		{
+			const auto& entry = table_[j][history_[j]];
+			for (size_t p = 0; p != L; ++p)
+			{
+				result[p] += entry[p];
+			}
+		}
+		for (size_t p = 0; p != L; ++p)
+		{
+			output[p] = result[p] / (1 << FRAC_BITS);
+		}
+	}
+
+	void reset()
+	{
+		history_.fill(MAX_LEVEL);	// level 0
+	}
+};
+
 template <typename FloatType, size_t N>
 BaseFirFilter<FloatType, N> makeFirFilter(const std::array<FloatType, N>& taps)
 {
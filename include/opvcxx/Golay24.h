@@ -5,9 +5,9 @@
 
 #include <array>
 #include <bit>
+#include <cstddef>
 #include <cstdint>
-#include <algorithm>
-#include <utility>
+#include <limits>
 
 namespace mobilinkd {
 
@@ -17,83 +17,9 @@ namespace mobilinkd {
 namespace Golay24
 {
 
-namespace detail
-{
-
-// Need a constexpr sort.
-// https://stackoverflow.com/a/40030044/854133
-template<class T>
-constexpr void swap(T& l, T& r)
-{
-    T tmp = std::move(l);
-    l = std::move(r);
-    r = std::move(tmp);
-}
-
-template <typename T, size_t N>
-struct array
-{
-    constexpr T& operator[](size_t i)
-    {
-        return arr[i];
-    }
-
-    constexpr const T& operator[](size_t i) const
-    {
-        return arr[i];
-    }
-
-    constexpr const T* begin() const
-    {
-        return arr;
-    }
-    constexpr const T* end() const
-    {
-        return arr + N;
-    }
-
-    T arr[N];
-};
-
-template <typename T, size_t N>
-constexpr void sort_impl(array<T, N> &array, size_t left, size_t right)
-{
-    if (left < right)
-    {
-        size_t m = left;
-
-        for (size_t i = left + 1; i<right; i++)
-            if (array[i]<array[left])
-                swap(array[++m], array[i]);
-
-        swap(array[left], array[m]);
-
-        sort_impl(array, left, m);
-        sort_impl(array, m + 1, right);
-    }
-}
-
-template <typename T, size_t N>
-constexpr array<T, N> sort(array<T, N> array)
-{
-    auto sorted = array;
-    sort_impl(sorted, 0, N);
-    return sorted;
-}
-
-} // detail
-
 // static constexpr uint16_t POLY = 0xAE3;
 constexpr uint16_t POLY = 0xC75;
 
-#pragma pack(push, 1)
-struct SyndromeMapEntry
-{
-    uint32_t a{0};
-    uint16_t b{0};
-};
-#pragma pack(pop)
-
 /**
  * Calculate the syndrome of a [23,12] Golay codeword.
  *
@@ -116,38 +42,32 @@ constexpr bool parity(uint32_t codeword)
     return std::popcount(codeword) & 1;
 }
 
-constexpr SyndromeMapEntry makeSyndromeMapEntry(uint64_t val)
-{
-    return SyndromeMapEntry{uint32_t(val >> 16), uint16_t(val & 0xFFFF)};
-}
-
-constexpr uint64_t makeSME(uint64_t syndrome, uint32_t bits)
-{
-    return (syndrome << 24) | (bits & 0xFFFFFF);
-}
-
 constexpr size_t LUT_SIZE = 2048;
 
-constexpr std::array<SyndromeMapEntry, LUT_SIZE> make_lut()
+/**
+ * Build the correction table, indexed by the 11-bit syndrome.  The code
+ * is perfect, so every syndrome belongs to exactly one error pattern of
+ * weight 3 or less and every entry is filled.
+ *
+ * @return the error pattern over the 23 codeword bits for each syndrome.
+ */
+constexpr std::array<uint32_t, LUT_SIZE> make_lut()
 {
     constexpr size_t VECLEN=23;
-    detail::array<uint64_t, LUT_SIZE> result{};
-
-    size_t index = 0;
-    result[index++] = makeSME(syndrome(0), 0);
+    std::array<uint32_t, LUT_SIZE> result{};
 
     for (size_t i = 0; i != VECLEN; ++i)
     {
-        auto v = (1 << i);
-        result[index++] = makeSME(syndrome(v), v);
+        uint32_t v = (1 << i);
+        result[syndrome(v) >> 12] = v;
     }
 
     for (size_t i = 0; i != VECLEN - 1; ++i)
     {
         for (size_t j = i + 1; j != VECLEN; ++j)
         {
-            auto v = (1 << i) | (1 << j);
-            result[index++] = makeSME(syndrome(v), v);
+            uint32_t v = (1 << i) | (1 << j);
+            result[syndrome(v) >> 12] = v;
         }
     }
 
@@ -157,21 +77,13 @@ constexpr std::array<SyndromeMapEntry, LUT_SIZE> make_lut()
         {
             for (size_t k = j + 1; k != VECLEN; ++k)
             {
-                auto v = (1 << i) | (1 << j) | (1 << k);
-                result[index++] = makeSME(syndrome(v), v);
+                uint32_t v = (1 << i) | (1 << j) | (1 << k);
+                result[syndrome(v) >> 12] = v;
             }
         }
     }
 
-    result = detail::sort(result);
-
-    std::array<SyndromeMapEntry, LUT_SIZE> tmp;
-    for (size_t i = 0; i != LUT_SIZE; ++i)
-    {
-        tmp[i] = makeSyndromeMapEntry(result[i]);
-    }
-
-    return tmp;
+    return result;
 }
 
 inline constexpr auto LUT = make_lut();
@@ -200,25 +112,163 @@ constexpr uint32_t encode24(uint16_t data)
     return ((codeword << 1) | parity(codeword));
 }
 
-bool decode(uint32_t input, uint32_t& output)
+/**
+ * Decode a [24,12] Golay codeword, correcting up to 3 bit errors in bits
+ * 23..1, the [23,12] codeword.  The parity bit (bit 0) is only checked
+ * when the syndrome has 3 or more bits set.  So an error in it is
+ * accepted, uncorrected, when all other errors are in bits 23..13, whose
+ * syndromes have one bit set, and is rejected otherwise.
+ *
+ * @return false if the errors could not be corrected.
+ */
+constexpr bool decode(uint32_t input, uint32_t& output)
 {
     auto syndrm = syndrome(input >> 1);
-    auto it = std::lower_bound(LUT.begin(), LUT.end(), syndrm,
-        [](const SyndromeMapEntry& sme, uint32_t val){
-            return (sme.a >> 8) < val;
-        });
+    // Apply the correction to the input.  syndrome() keeps 24 bits of
+    // input >> 1, so a set bit 24 leaves a 12th syndrome bit that no
+    // error pattern has.  The mask keeps the table index in bounds and
+    // such inputs are rejected below.
+    output = input ^ (LUT[(syndrm >> 12) & (LUT_SIZE - 1)] << 1);
+    // Only test parity for 3-bit errors.
+    return (syndrm >> 12) < LUT_SIZE && (std::popcount(syndrm) < 3 || !parity(output));
+}
+
+/**
+ * Decode @p N codewords, such as all of those in a frame header.
+ *
+ * @return a mask with bit i set if codeword i could not be decoded.
+ */
+template <size_t N>
+constexpr uint32_t decode_n(const std::array<uint32_t, N>& input, std::array<uint32_t, N>& output)
+{
+    static_assert(N <= 32);
+
+    uint32_t failed = 0;
+    for (size_t i = 0; i != N; ++i)
+    {
+        failed |= uint32_t(!decode(input[i], output[i])) << i;
+    }
+    return failed;
+}
+
+/**
+ * Correlation of a codeword with its soft bits.
+ *
+ * @param soft the 24 soft bits, MSB first, positive for 1.
+ */
+constexpr int32_t correlation(const int8_t* soft, uint32_t codeword)
+{
+    int32_t result = 0;
+    for (size_t i = 0; i != 24; ++i)
+    {
+        result += ((codeword >> (23 - i)) & 1) ? soft[i] : -soft[i];
+    }
+    return result;
+}
+
+/**
+ * Soft decision (Chase-II) decoding of a [24,12] Golay codeword.
+ *
+ * The P least reliable bits are flipped in every combination.  Each test
+ * word is decoded with decode(), and the candidate with the highest
+ * correlation with the soft bits is chosen.  This corrects many 4 and 5
+ * bit error patterns when some of the errors are weak, and never does
+ * worse than decode() on the hard decisions.
+ *
+ * Nearly every word is within a few bits of some codeword, so a candidate
+ * more than 3 bits from the hard decisions is only accepted if the bits
+ * it corrects are together less reliable than an average bit.  Otherwise
+ * random soft bits would almost always decode to something.
+ *
+ * @param soft the 24 soft bits, MSB first, positive for 1.
+ * @param output the decoded codeword.
+ * @param confidence the correlation of the codeword with the soft bits.
+ *  It is the sum of |soft| when no bit was corrected and drops by twice
+ *  the reliability of each corrected bit.
+ * @return false if no test word gave an acceptable candidate.
+ */
+template <size_t P = 4>
+constexpr bool decode_soft(const int8_t* soft, uint32_t& output, int32_t& confidence)
+{
+    static_assert(P <= 8);
+
+    // Hard decisions and the P least reliable bits, least reliable first.
+    uint32_t hard = 0;
+    int32_t total = 0;
+    std::array<uint32_t, P> flip{};
+    std::array<int32_t, P> weakest{};
+    weakest.fill(std::numeric_limits<int32_t>::max());
+    for (size_t i = 0; i != 24; ++i)
+    {
+        uint32_t bit = 1U << (23 - i);
+        if (soft[i] > 0) hard |= bit;
+
+        int32_t r = soft[i] < 0 ? -soft[i] : soft[i];
+        total += r;
+        for (size_t p = 0; p != P; ++p)
+        {
+            if (r < weakest[p])
+            {
+                for (size_t q = P - 1; q != p; --q)
+                {
+                    weakest[q] = weakest[q - 1];
+                    flip[q] = flip[q - 1];
+                }
+                weakest[p] = r;
+                flip[p] = bit;
+                break;
+            }
+        }
+    }
 
-    if ((it->a >> 8) == syndrm)
+    bool found = false;
+    for (uint32_t t = 0; t != (1U << P); ++t)
     {
-        // Build the correction from the compressed entry.
-        auto correction = ((((it->a & 0xFF) << 16) | it->b) << 1);
-        // Apply the correction to the input.
-        output = input ^ correction;
-        // Only test parity for 3-bit errors.
-        return std::popcount(syndrm) < 3 || !parity(output);
+        uint32_t test = hard;
+        for (size_t p = 0; p != P; ++p)
+        {
+            if (t & (1U << p)) test ^= flip[p];
+        }
+
+        uint32_t decoded = 0;
+        if (!decode(test, decoded)) continue;
+
+        // decode() does not correct the parity bit.
+        uint32_t candidate = encode24(decoded >> 12);
+        int32_t c = correlation(soft, candidate);
+
+        // Each corrected bit lowers the correlation by twice its
+        // reliability, and the average reliability is total / 24.
+        if (std::popcount(candidate ^ hard) > 3 && c < total - total / 12) continue;
+
+        if (!found || c > confidence)
+        {
+            found = true;
+            output = candidate;
+            confidence = c;
+        }
     }
+    return found;
+}
+
+/**
+ * Soft decode @p N consecutive codewords, such as all of those in a frame
+ * header.
+ *
+ * @return a mask with bit i set if codeword i could not be decoded.
+ */
+template <size_t N, size_t P = 4>
+constexpr uint32_t decode_soft_n(const int8_t* soft, std::array<uint32_t, N>& output,
+    std::array<int32_t, N>& confidence)
+{
+    static_assert(N <= 32);
 
-    return false;
+    uint32_t failed = 0;
+    for (size_t i = 0; i != N; ++i)
+    {
+        failed |= uint32_t(!decode_soft<P>(soft + 24 * i, output[i], confidence[i])) << i;
+    }
+    return failed;
 }
 
 } // Golay24
@@ -0,0 +1,168 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include "Viterbi.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+namespace mobilinkd
+{
+
+/**
+ * Soft output decoder for the convolutional code, using the max-log-MAP
+ * (min-sum BCJR) algorithm.
+ *
+ * Viterbi gives hard bits and one cost for the frame.  This decoder also
+ * gives a reliability for each bit: the difference between the best path
+ * with the bit set to 0 and the best path with the bit set to 1.  It uses
+ * the same branch metric as Viterbi, so the sign of each output LLR is the
+ * bit Viterbi decodes (except where the two paths tie) and the cost is the
+ * same.  A forward pass stores every step's state metrics and a backward
+ * pass produces the LLRs.  Both are scalar code, so a frame costs several
+ * times a vectorized Viterbi decode.  MaxLogMapTest has a benchmark.
+ */
+template <typename Trellis_, size_t LLR_ = 2>
+struct MaxLogMap
+{
+    using viterbi_t = Viterbi<Trellis_, LLR_>;
+    using metrics_t = typename viterbi_t::metrics_t;
+
+    static constexpr size_t NumStates = viterbi_t::NumStates;
+    static constexpr size_t BUTTERFLY_SIZE = NumStates / 2;
+
+    static_assert(Trellis_::n == 2 && Trellis_::k == 1);
+
+    viterbi_t viterbi_;             // Trellis tables.
+    std::vector<metrics_t> alpha_;  // Forward state metrics for each step.
+
+    MaxLogMap(Trellis_ trellis)
+    : viterbi_(trellis)
+    {}
+
+    /**
+     * Decode one frame of LLRs where 0 == erasure.
+     *
+     * @param out receives one LLR per decoded bit.  It is positive for a
+     *  1.  The magnitude is in path metric units, saturated to int16.
+     * @return path metric for estimating BER, as from Viterbi::decode().
+     */
+    template <size_t IN, size_t OUT>
+    size_t decode(std::array<int8_t, IN> const& in, std::array<int16_t, OUT>& out)
+    {
+        constexpr size_t steps = IN / 2;
+        static_assert(OUT <= steps);
+
+        constexpr auto MAX_METRIC = std::numeric_limits<int32_t>::max() / 2;
+
+        std::array<int16_t, BUTTERFLY_SIZE> cost0;
+        std::array<int16_t, BUTTERFLY_SIZE> cost1;
+
+        alpha_.resize(steps + 1);
+        alpha_[0].fill(MAX_METRIC);
+        alpha_[0][0] = 0;     // Starting point.
+
+        // Forward pass.  Butterfly j feeds states 2j and 2j+1 from states j
+        // and j + BUTTERFLY_SIZE, as in Viterbi.
+        for (size_t t = 0; t != steps; ++t)
+        {
+            branch_costs(in[t * 2], in[t * 2 + 1], cost0, cost1);
+            const auto& a = alpha_[t];
+            auto& next = alpha_[t + 1];
+            for (size_t j = 0; j != BUTTERFLY_SIZE; ++j)
+            {
+                int32_t a0 = a[j];
+                int32_t a1 = a[j + BUTTERFLY_SIZE];
+                next[2 * j] = std::min(a0 + cost0[j], a1 + cost1[j]);
+                next[2 * j + 1] = std::min(a0 + cost1[j], a1 + cost0[j]);
+            }
+        }
+
+        const auto& last = alpha_[steps];
+        int32_t min_cost = *std::min_element(last.begin(), last.end());
+
+        // Backward pass.  The frame may end in any state, as in Viterbi.
+        metrics_t beta{};
+        metrics_t prev;
+        for (size_t t = steps; t != 0; --t)
+        {
+            branch_costs(in[t * 2 - 2], in[t * 2 - 1], cost0, cost1);
+            const auto& a = alpha_[t - 1];
+
+            int32_t best0 = MAX_METRIC * 2;     // best path through a 0 bit
+            int32_t best1 = MAX_METRIC * 2;
+            for (size_t j = 0; j != BUTTERFLY_SIZE; ++j)
+            {
+                int32_t a0 = a[j];
+                int32_t a1 = a[j + BUTTERFLY_SIZE];
+                int32_t b0 = beta[2 * j];
+                int32_t b1 = beta[2 * j + 1];
+
+                best0 = std::min({best0, a0 + cost0[j] + b0, a1 + cost1[j] + b0});
+                best1 = std::min({best1, a0 + cost1[j] + b1, a1 + cost0[j] + b1});
+
+                prev[j] = std::min(cost0[j] + b0, cost1[j] + b1);
+                prev[j + BUTTERFLY_SIZE] = std::min(cost1[j] + b0, cost0[j] + b1);
+            }
+            beta = prev;
+
+            if (t <= OUT)
+            {
+                out[t - 1] = std::clamp<int32_t>(best0 - best1,
+                    std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+            }
+        }
+
+        return std::round(min_cost / float(detail::llr_limit<LLR_>()));
+    }
+
+private:
+
+    void branch_costs(int16_t s0, int16_t s1,
+        std::array<int16_t, BUTTERFLY_SIZE>& cost0,
+        std::array<int16_t, BUTTERFLY_SIZE>& cost1) const
+    {
+        const auto& cost = viterbi_.cost_;
+        for (size_t j = 0; j != BUTTERFLY_SIZE; ++j)
+        {
+            cost0[j] = 0;
+            cost1[j] = 0;
+            if (s0) // is not erased
+            {
+                cost0[j] = std::abs(cost[j][0] - s0);
+                cost1[j] = std::abs(cost[j][0] + s0);
+            }
+            if (s1) // is not erased
+            {
+                cost0[j] += std::abs(cost[j][1] - s1);
+                cost1[j] += std::abs(cost[j][1] + s1);
+            }
+        }
+    }
+};
+
+/**
+ * Reduce per-bit LLRs to a confidence for each byte: the smallest |LLR| of
+ * its 8 bits.  Bits are packed MSB first, as in to_byte_array().
+ */
+template <size_t N>
+std::array<uint16_t, (N + 7) / 8> byte_confidence(std::array<int16_t, N> const& llr)
+{
+    std::array<uint16_t, (N + 7) / 8> result;
+    result.fill(std::numeric_limits<uint16_t>::max());
+    for (size_t i = 0; i != N; ++i)
+    {
+        uint16_t c = std::abs(int32_t(llr[i]));
+        result[i / 8] = std::min(result[i / 8], c);
+    }
+    return result;
+}
+
+} // mobilinkd
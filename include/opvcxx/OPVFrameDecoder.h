@@ -25,7 +25,8 @@ struct OPVFrameDecoder
 {
 
     OPVRandomizer<stream_type4_size> derandomize_;
-    PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size> interleaver_;
+    using interleaver_t = PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size>;
+    interleaver_t interleaver_;
     Trellis<4,2> trellis_{makeTrellis<4, 2>({ConvolutionPolyA,ConvolutionPolyB})};
     Viterbi<decltype(trellis_), 4> viterbi_{trellis_};
  
@@ -44,6 +45,9 @@ struct OPVFrameDecoder
     using stream_type1_buffer_t = std::array<uint8_t, stream_frame_payload_size>;    // decoded stream payload
     using stream_type1_bytes_t = std::array<uint8_t, stream_frame_payload_bytes>;   // decoded stream payload (packed)
 
+    static_assert(encoded_fheader_size + stream_type3_payload_size == stream_type4_size);
+    static_assert(encoded_fheader_size % 8 == 0, "unpack() gathers 8 bits at a time");
+
     using output_buffer_t = struct {
         FrameType type;
         OPVFrameHeader fheader;
@@ -62,9 +66,18 @@ struct OPVFrameDecoder
     output_buffer_t output_buffer;
     OPVFrameHeader fheader_;
 
+    // Randomizer signs in deinterleaved order, so that unpack() can
+    // derandomize and deinterleave with one gather.
+    std::array<int8_t, stream_type4_size> signs_;
+
     OPVFrameDecoder(callback_t callback)
     : callback_(callback)
-    {}
+    {
+        for (size_t i = 0; i != stream_type4_size; ++i)
+        {
+            signs_[i] = derandomize_.dc_[interleaver_.index(i)];
+        }
+    }
 
 
     void reset()
@@ -77,6 +90,8 @@ struct OPVFrameDecoder
     {
         stream_type1_buffer_t decode_buffer;
 
+        // The payload is only complete once the whole frame has been
+        // deinterleaved, so a StreamingViterbi would not decode any sooner.
         viterbi_cost = viterbi_.decode(buffer, decode_buffer);
         to_byte_array(decode_buffer, output_buffer.data);
 
@@ -93,6 +108,19 @@ struct OPVFrameDecoder
     }
 
 
+    /**
+     * Derandomize and deinterleave a received frame straight into the
+     * header and payload buffers, in a single pass.  The frame is read in
+     * place and not modified.
+     */
+    void unpack(const int8_t* frame, encoded_fheader_t& encoded_fheader,
+        stream_type3_buffer_t& encoded_payload) const
+    {
+        interleaver_t::deinterleave(frame, signs_.data(), 0, encoded_fheader_size, encoded_fheader.data());
+        interleaver_t::deinterleave(frame, signs_.data(), encoded_fheader_size, stream_type3_payload_size, encoded_payload.data());
+    }
+
+
     /**
      * Decode OPV frames.
      * 
@@ -101,17 +129,20 @@ struct OPVFrameDecoder
      * (excluding the sync word).
      */
     DecodeResult operator()(frame_type4_buffer_t& buffer, size_t& viterbi_cost)
+    {
+        return (*this)(buffer.data(), viterbi_cost);
+    }
+
+    /**
+     * Decode an OPV frame directly from the framer's buffer, which must
+     * hold stream_type4_size soft bits.
+     */
+    DecodeResult operator()(const int8_t* buffer, size_t& viterbi_cost)
     {
         encoded_fheader_t encoded_fheader;
-        fheader_flags_t fheader_flags;
         stream_type3_buffer_t encoded_payload;
-        stream_type1_buffer_t payload;
-
-        derandomize_(buffer);
-        interleaver_.deinterleave(buffer);
 
-        std::copy(buffer.begin(), buffer.begin() + encoded_fheader_size, encoded_fheader.begin());
-        std::copy(buffer.begin() + encoded_fheader_size, buffer.end(), encoded_payload.begin());
+        unpack(buffer, encoded_fheader, encoded_payload);
 
         switch (fheader_.update_frame_header(encoded_fheader))
         {
@@ -8,6 +8,7 @@
 #include "Util.h"
 
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <string_view> // Don't have std::span in C++17.
 #include <stdexcept>
@@ -28,6 +29,8 @@ struct OPVFrameHeader
     using raw_fheader_t = std::array<uint8_t, fheader_size_bytes>;
     using encoded_fheader_t = std::array<int8_t, encoded_fheader_size>; // Frame Header (type 2/3)
 
+    static constexpr size_t golay_codewords = fheader_size_bytes * 2 / 3;     // 12 bits each
+
     static constexpr flags_t LAST_FRAME = 0x800000;
     static constexpr flags_t BERT_MODE  = 0x400000;
 
@@ -129,10 +132,10 @@ struct OPVFrameHeader
 
 
     // Initialize/update the frame header info from a received frame header.
-    // Any failure to decode a Golay24 codeword will abort this procedure.  !!! this could be smarter
+    // The Golay24 codewords are soft decoded; any failure to decode one will
+    // abort this procedure.
     HeaderResult update_frame_header(encoded_fheader_t efh_soft_bits)
     {
-        uint32_t received, decoded;
         raw_fheader_t raw_fh;
         std::array<uint8_t, fheader_size_bytes * 2> nibbles;
         encoded_call_t  call;
@@ -169,20 +172,24 @@ struct OPVFrameHeader
         std::cerr << std::dec << std::endl;
 #endif
 
-        // For convenience, we'll decode into an array of nibbles (4 bits each)
-        // initially and then group them up into bytes afterwards.
-        for (size_t i = 0; i < fheader_size_bytes * 2; i += 3)
+        // Soft decode all the codewords in one call.  For convenience, we'll
+        // decode into an array of nibbles (4 bits each) initially and then
+        // group them up into bytes afterwards.
+        std::array<uint32_t, golay_codewords> decoded;
+        std::array<int32_t, golay_codewords> confidence;
+        if (auto failed = Golay24::decode_soft_n(efh_soft_bits.data(), decoded, confidence))
         {
-            received = ((efh[i+0] << 16) & 0xff0000) | ((efh[i+1] << 8) & 0x00ff00) | (efh[i+2] & 0x0000ff);
-            if (! Golay24::decode(received, decoded))
-            {
-                std::cerr << "Golay decode fail, input " << std::hex << received << std::dec << " at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
-                return HeaderResult::FAIL;
-            }
-//            std::cerr << "Golay " << std::hex << received << " decoded to " << decoded << std::dec << std::endl;    //!!! debug
-            nibbles[i+0] = (decoded >> 20) & 0x0f;
-            nibbles[i+1] = (decoded >> 16) & 0x0f;
-            nibbles[i+2] = (decoded >> 12) & 0x0f;
+            auto i = std::countr_zero(failed);
+            uint32_t received = ((efh[3*i+0] << 16) & 0xff0000) | ((efh[3*i+1] << 8) & 0x00ff00) | (efh[3*i+2] & 0x0000ff);
+            std::cerr << "Golay decode fail, input " << std::hex << received << std::dec << " at sample " << debug_sample_count << " (" << float(debug_sample_count)/samples_per_frame << " frames)" << std::endl; //!!! debug
+            return HeaderResult::FAIL;
+        }
+
+        for (size_t i = 0; i != golay_codewords; ++i)
+        {
+            nibbles[3*i+0] = (decoded[i] >> 20) & 0x0f;
+            nibbles[3*i+1] = (decoded[i] >> 16) & 0x0f;
+            nibbles[3*i+2] = (decoded[i] >> 12) & 0x0f;
         }
 
         for (size_t i = 0; i < fheader_size_bytes; i++)
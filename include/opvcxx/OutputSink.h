@@ -0,0 +1,201 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace mobilinkd
+{
+
+/**
+ * Buffered binary output to a file descriptor, for the baseband, bit
+ * stream and audio the apps write to stdout.
+ *
+ * Writes are copied into a preallocated buffer, which goes out with one
+ * write(2) when it fills up or on flush().  A write that does not fit is
+ * sent together with the buffer using writev(2), without copying it.  The
+ * destructor flushes.
+ *
+ * On a write error the message is printed once and further output is
+ * dropped, as iostreams do after a failure.
+ *
+ * Windows has no writev(2), so there the pieces are written one at a time,
+ * and the file descriptor is put in binary mode.
+ */
+class OutputSink
+{
+    int fd_;
+    bool owned_ = false;
+    bool failed_ = false;
+    std::vector<uint8_t> buffer_;
+    size_t size_ = 0;
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+#if defined(_WIN32)
+    struct iovec
+    {
+        void* iov_base;
+        size_t iov_len;
+    };
+
+    // Returns the number of bytes written, or -1 on error.
+    long long write_some(const iovec* iov, int)
+    {
+        return ::_write(fd_, iov->iov_base, static_cast<unsigned>(std::min<size_t>(iov->iov_len, 1u << 30)));
+    }
+
+    static int open_file(const std::string& path)
+    {
+        return ::_open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+
+    static void close_file(int fd) { ::_close(fd); }
+#else
+    long long write_some(const iovec* iov, int count)
+    {
+        return ::writev(fd_, iov, count);
+    }
+
+    static int open_file(const std::string& path)
+    {
+        return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    static void close_file(int fd) { ::close(fd); }
+#endif
+
+    void fail(const char* what)
+    {
+        if (!failed_) std::cerr << "Output " << what << " failed: " << strerror(errno) << std::endl;
+        failed_ = true;
+    }
+
+    // Write all of iov, continuing after partial writes and signals.
+    void write_all(iovec* iov, int count)
+    {
+        while (count != 0 && !failed_)
+        {
+            long long written = write_some(iov, count);
+            if (written < 0)
+            {
+                if (errno == EINTR) continue;
+                fail("write");
+                return;
+            }
+
+            size_t n = written;
+            while (count != 0 && n >= iov->iov_len)
+            {
+                n -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count != 0)
+            {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + n;
+                iov->iov_len -= n;
+            }
+        }
+    }
+
+public:
+
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+    static constexpr int STDOUT = 1;    // STDOUT_FILENO
+
+    /**
+     * Write to an open file descriptor, which is not closed.
+     */
+    explicit OutputSink(int fd = STDOUT, size_t capacity = DEFAULT_CAPACITY)
+    : fd_(fd), buffer_(capacity)
+    {
+#if defined(_WIN32)
+        ::_setmode(fd_, _O_BINARY);
+#endif
+    }
+
+    /**
+     * Create or truncate the file at @p path and write to it.
+     */
+    explicit OutputSink(const std::string& path, size_t capacity = DEFAULT_CAPACITY)
+    : fd_(open_file(path)), owned_(true), buffer_(capacity)
+    {
+        if (fd_ < 0) fail(("open of " + path).c_str());
+    }
+
+    ~OutputSink()
+    {
+        flush();
+        if (owned_ && fd_ >= 0) close_file(fd_);
+    }
+
+    void write(const void* data, size_t count)
+    {
+        if (count <= buffer_.size() - size_)
+        {
+            std::memcpy(buffer_.data() + size_, data, count);
+            size_ += count;
+            return;
+        }
+
+        iovec iov[2] = {{buffer_.data(), size_}, {const_cast<void*>(data), count}};
+        write_all(iov, 2);
+        size_ = 0;
+    }
+
+    void put(uint8_t c)
+    {
+        if (size_ == buffer_.size()) flush();
+        buffer_[size_++] = c;
+    }
+
+    /**
+     * Write 16-bit samples in little-endian order.
+     */
+    void write_le(const int16_t* samples, size_t count)
+    {
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            write(samples, count * sizeof(int16_t));
+        }
+        else
+        {
+            for (size_t i = 0; i != count; ++i)
+            {
+                put(uint16_t(samples[i]) & 0xFF);
+                put(uint16_t(samples[i]) >> 8);
+            }
+        }
+    }
+
+    void flush()
+    {
+        if (size_ == 0) return;
+
+        iovec iov = {buffer_.data(), size_};
+        write_all(&iov, 1);
+        size_ = 0;
+    }
+
+    bool failed() const { return failed_; }
+};
+
+} // mobilinkd
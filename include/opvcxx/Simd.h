@@ -0,0 +1,45 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+// Instruction set detection for the vectorized kernels.
+//
+// SSE2 and AVX2 kernels are compiled with a function-level target attribute
+// and are selected at run time, so the library still runs on x86 machines
+// without AVX2.  NEON is part of the AArch64 baseline and is selected at
+// compile time.  Everything else falls back to the scalar code.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define OPV_SIMD_X86 1
+#define OPV_TARGET_SSE2 __attribute__((target("sse2")))
+#define OPV_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define OPV_SIMD_NEON 1
+#endif
+
+namespace mobilinkd
+{
+
+enum class SimdLevel { SCALAR, SSE2, NEON, AVX2 };
+
+/**
+ * The best instruction set available on the running CPU.  The check is
+ * done once and cached.
+ */
+inline SimdLevel simd_level()
+{
+#if defined(OPV_SIMD_X86)
+    static const SimdLevel level =
+        __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 :
+        __builtin_cpu_supports("sse2") ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+    return level;
+#elif defined(OPV_SIMD_NEON)
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+} // mobilinkd
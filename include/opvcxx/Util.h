@@ -2,12 +2,17 @@
 
 #pragma once
 
+#include "Simd.h"
+
 #include <algorithm>
 #include <cstdlib>
 #include <cassert>
 #include <array>
 #include <bitset>
+#include <cmath>
+#include <cstdint>
 #include <tuple>
+#include <type_traits>
 #include <limits>
 
 
@@ -102,6 +107,110 @@ constexpr std::array<std::tuple<FloatType, std::tuple<int8_t, int8_t>>, llr_size
     return result;
 }
 
+/**
+ * The LLR map split into its keys and values, for llr().  key[0] is the
+ * lowest value and key[i + 1] is the key of map entry i, so that both
+ * neighbours of an entry can be read without a bounds check.
+ */
+template<typename FloatType, size_t LLR>
+struct LlrTable
+{
+    static constexpr size_t size = llr_size<LLR>();
+
+    std::array<FloatType, size + 1> key;
+    std::array<int8_t, size> first;
+    std::array<int8_t, size> second;
+    std::array<int32_t, size> pair;     // first and second in the low bytes
+
+    constexpr LlrTable()
+    : key(), first(), second(), pair()
+    {
+        constexpr auto map = make_llr_map<FloatType, LLR>();
+        key[0] = std::numeric_limits<FloatType>::lowest();
+        for (size_t i = 0; i != size; ++i)
+        {
+            key[i + 1] = std::get<0>(map[i]);
+            first[i] = std::get<0>(std::get<1>(map[i]));
+            second[i] = std::get<1>(std::get<1>(map[i]));
+            pair[i] = uint8_t(first[i]) | (uint8_t(second[i]) << 8);
+        }
+    }
+
+    /**
+     * The index of the first key not less than @p s, as std::lower_bound()
+     * would find it, for -3 <= s <= 3.  The keys are about 1/limit apart,
+     * so the index is estimated from s and then corrected by one step
+     * against the keys on either side of it.
+     */
+    int index(FloatType s) const
+    {
+        constexpr auto limit = FloatType(llr_limit<LLR>());
+        int i = std::ceil((s - FloatType(-3)) * limit - FloatType(1));
+        i = std::clamp(i, 0, int(size) - 1);
+        i += int(key[i + 1] < s) - int(key[i] >= s);
+        return std::clamp(i, 0, int(size) - 1);
+    }
+};
+
+template <typename FloatType, size_t LLR>
+void llr_block(const FloatType* samples, size_t count, int8_t* out)
+{
+    static constexpr LlrTable<FloatType, LLR> table;
+
+    for (size_t n = 0; n != count; ++n)
+    {
+        FloatType s = std::min(FloatType(3), std::max(FloatType(-3), samples[n]));
+        int i = table.index(s);
+        out[n * 2] = table.first[i];
+        out[n * 2 + 1] = table.second[i];
+    }
+}
+
+#if defined(OPV_SIMD_X86)
+// Eight symbols at a time, with gathers for the table reads.
+template <size_t LLR>
+OPV_TARGET_AVX2
+void llr_block_avx2(const float* samples, size_t count, int8_t* out)
+{
+    static constexpr LlrTable<float, LLR> table;
+
+    const __m256 min_value = _mm256_set1_ps(-3.0f);
+    const __m256 max_value = _mm256_set1_ps(3.0f);
+    const __m256 limit = _mm256_set1_ps(float(llr_limit<LLR>()));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256i first = _mm256_setzero_si256();
+    const __m256i last = _mm256_set1_epi32(table.size - 1);
+    // The low two bytes of each 32-bit lane, to the low 8 bytes of each half.
+    const __m256i pairs = _mm256_setr_epi8(
+        0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+        0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    size_t n = 0;
+    for (; n + 8 <= count; n += 8)
+    {
+        // max_ps returns its second operand for a NaN, as std::max() does.
+        __m256 s = _mm256_loadu_ps(samples + n);
+        s = _mm256_min_ps(_mm256_max_ps(s, min_value), max_value);
+
+        __m256 estimate = _mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(s, min_value), limit), one);
+        __m256i i = _mm256_cvttps_epi32(_mm256_ceil_ps(estimate));
+        i = _mm256_min_epi32(_mm256_max_epi32(i, first), last);
+
+        // The compare masks are -1 where true.
+        __m256 above = _mm256_i32gather_ps(table.key.data() + 1, i, 4);
+        __m256 below = _mm256_i32gather_ps(table.key.data(), i, 4);
+        i = _mm256_sub_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(above, s, _CMP_LT_OQ)));
+        i = _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(below, s, _CMP_GE_OQ)));
+        i = _mm256_min_epi32(_mm256_max_epi32(i, first), last);
+
+        __m256i llrs = _mm256_i32gather_epi32(table.pair.data(), i, 4);
+        llrs = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(llrs, pairs), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n * 2), _mm256_castsi256_si128(llrs));
+    }
+    llr_block<float, LLR>(samples + n, count - n, out + n * 2);
+}
+#endif
+
 }
 
 template<class...Bools>
@@ -124,23 +233,43 @@ inline int from_4fsk(int symbol)
     }
 }
 
+/**
+ * Convert a corrected symbol into a pair of LLRs, one for each bit.  The
+ * result is the entry of make_llr_map() found by a binary search on the
+ * clamped symbol, computed with a table index instead of a search.
+ */
 template <typename FloatType, size_t LLR>
 auto llr(FloatType sample)
 {
-    static constexpr auto symbol_map = detail::make_llr_map<FloatType, LLR>();
+    static constexpr detail::LlrTable<FloatType, LLR> table;
     static constexpr FloatType MAX_VALUE = 3.0;
     static constexpr FloatType MIN_VALUE = -3.0;
 
     FloatType s = std::min(MAX_VALUE, std::max(MIN_VALUE, sample));
 
-    auto it = std::lower_bound(symbol_map.begin(), symbol_map.end(), s,
-        [](std::tuple<FloatType, std::tuple<int8_t, int8_t>> const& e, FloatType s){
-            return std::get<0>(e) < s;
-        });
-    
-    if (it == symbol_map.end()) return std::get<1>(*symbol_map.rbegin());
+    int i = table.index(s);
+    return std::make_tuple(table.first[i], table.second[i]);
+}
 
-    return std::get<1>(*it);
+/**
+ * Convert a block of corrected symbols into LLR pairs, as llr() does one
+ * symbol at a time.  @p out receives 2 * count LLRs.  On x86 it uses
+ * AVX2 gathers for float when the CPU has them.
+ */
+template <typename FloatType, size_t LLR>
+void llr(const FloatType* samples, size_t count, int8_t* out)
+{
+#if defined(OPV_SIMD_X86)
+    if constexpr (std::is_same_v<FloatType, float>)
+    {
+        if (simd_level() == SimdLevel::AVX2)
+        {
+            detail::llr_block_avx2<LLR>(samples, count, out);
+            return;
+        }
+    }
+#endif
+    detail::llr_block<FloatType, LLR>(samples, count, out);
 }
 
 
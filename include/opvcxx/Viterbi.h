@@ -6,13 +6,17 @@
 #include "Convolution.h"
 #include "Util.h"
 #include "Numerology.h"
+#include "Simd.h"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <limits>
+#include <type_traits>
 
 namespace mobilinkd
 {
@@ -88,14 +92,44 @@ constexpr auto makeCost(Trellis_ trellis)
     return result;
 }
 
+namespace detail
+{
+
+/**
+ * Spread the low 8 bits of x to the even bit positions of a 16-bit word.
+ * Used to merge the two per-butterfly decision masks into a per-state mask.
+ */
+constexpr uint32_t spread_bits(uint32_t x)
+{
+    x = (x | (x << 4)) & 0x0F0F;
+    x = (x | (x << 2)) & 0x3333;
+    x = (x | (x << 1)) & 0x5555;
+    return x;
+}
+
+} // detail
+
 /**
  * Soft decision Viterbi algorithm based on the trellis and LLR size.
  *
+ * The add-compare-select loop has vectorized kernels for the 16-state
+ * (K=4) trellis.  The kernel is chosen at run time from simd_level() and
+ * produces the same decisions and cost as the scalar code.
+ *
+ * The scalar code uses int32 path metrics.  The vector kernels use int16
+ * metrics and periodically renormalize by subtracting the smallest metric,
+ * so all 16 states fit in one 256-bit register.
+ *
+ * The survivor decisions for each step are stored as one packed word with
+ * bit i set when state i was reached from its upper predecessor.  The
+ * vector kernels write the compare mask straight into the word and the
+ * chainback reads single bits back out with a shift.
  */
 template <typename Trellis_, size_t LLR_ = 2>
 struct Viterbi
 {
     static_assert(LLR_ < 7);    // Need to be < 7 to avoid overflow errors.
+    static_assert(Trellis_::K <= 6);    // Decisions for one step must fit in a decision_t.
 
     static constexpr size_t K = Trellis_::K;
     static constexpr size_t k = Trellis_::k;
@@ -105,9 +139,35 @@ struct Viterbi
     static constexpr int32_t METRIC = ((1 << (LLR_ - 1)) - 1) << 2;
 
     using metrics_t = std::array<int32_t, NumStates>;
+    using metrics16_t = std::array<int16_t, NumStates>;
+    using decision_t = std::conditional_t<NumStates <= 8, uint8_t,
+        std::conditional_t<NumStates <= 16, uint16_t,
+        std::conditional_t<NumStates <= 32, uint32_t, uint64_t>>>;
     using cost_t = std::array<std::array<int16_t, n>, NumStates>;
     using state_transition_t = std::array<std::array<uint8_t, 2>, NumStates>;
 
+    // Bounds for the int16 metrics used by the vector kernels.
+    //
+    // Every RENORM_INTERVAL steps the smallest metric is subtracted from
+    // all of them, making it 0.  Any state can be reached from any other in
+    // K steps and metrics never decrease, so no reachable state is more than
+    // K * MAX_BRANCH above the smallest one.  States not yet reachable from
+    // the start state begin at METRIC16_INIT, which is larger than any
+    // reachable metric, so they lose every compare to a reachable path just
+    // like INT32_MAX/2 in the scalar code, and the decisions are identical.
+    // Between renormalizations each metric grows by at most MAX_BRANCH per
+    // step, so the largest sum ever formed is METRIC16_INIT + (K +
+    // RENORM_INTERVAL) * MAX_BRANCH whatever the frame length.  The
+    // subtracted minimums are accumulated in an int32, which is bounded by
+    // steps * MAX_BRANCH.
+    static constexpr int32_t MAX_BRANCH = n * (128 + detail::llr_limit<LLR_>());  // any int8 input
+    static constexpr int16_t METRIC16_INIT = 2048;
+    static constexpr size_t RENORM_INTERVAL = 16;
+
+    static_assert(METRIC16_INIT > K * MAX_BRANCH);
+    static_assert(METRIC16_INIT + (K + RENORM_INTERVAL) * MAX_BRANCH <= std::numeric_limits<int16_t>::max());
+    static_assert(int64_t(stream_type3_payload_size / 2) * MAX_BRANCH < std::numeric_limits<int32_t>::max());
+
     metrics_t pathMetrics_{};
     cost_t cost_;
     state_transition_t nextState_;
@@ -115,10 +175,12 @@ struct Viterbi
 
     metrics_t prevMetrics, currMetrics;
 
+    SimdLevel simd_ = simd_level();     // Set to SCALAR to force the reference kernel.
+
     // This is the maximum amount of storage needed for M17.  If used for
     // other modes, this may need to be increased.  This will never overflow
     // because of a static assertion in the decode() function.
-    std::array<std::bitset<NumStates>, stream_type3_payload_size / 2> history_;   //!!! revise for OPV (crashing) was 244 for M17
+    std::array<decision_t, stream_type3_payload_size / 2> history_;
 
     Viterbi(Trellis_ trellis)
     : cost_(makeCost<Trellis_, LLR_>(trellis))
@@ -126,10 +188,14 @@ struct Viterbi
     , prevState_(makePrevState(trellis))
     {}
 
-    void calculate_path_metric(
+    /**
+     * Add-compare-select for butterfly @p j.
+     *
+     * @return the decision bits for the two destination states.
+     */
+    decision_t calculate_path_metric(
         const std::array<int16_t, NumStates / 2>& cost0,
         const std::array<int16_t, NumStates / 2>& cost1,
-        std::bitset<NumStates>& hist,
         size_t j
     ) {
         auto& i0 = nextState_[j][0];
@@ -149,40 +215,26 @@ struct Viterbi
         bool d0 = m0 > m2;
         bool d1 = m1 > m3;
 
-        hist.set(i0, d0);
-        hist.set(i1, d1);
         currMetrics[i0] = d0 ? m2 : m0;
         currMetrics[i1] = d1 ? m3 : m1;
+        return (decision_t(d0) << i0) | (decision_t(d1) << i1);
     }
 
     /**
-     * Viterbi soft decoder using LLR inputs where 0 == erasure.
-     * 
-     * @return path metric for estimating BER.
+     * Scalar add-compare-select over @p steps bit pairs.  This is the
+     * reference implementation for the vectorized kernels.
      */
-    template <size_t IN, size_t OUT>
-    size_t decode(std::array<int8_t, IN> const& in, std::array<uint8_t, OUT>& out)
+    void forward_scalar(const int8_t* in, size_t steps, decision_t* hist)
     {
-        static_assert(sizeof(history_) >= IN / 2);
-
-        constexpr auto MAX_METRIC = std::numeric_limits<typename metrics_t::value_type>::max() / 2;
-
-        prevMetrics.fill(MAX_METRIC);
-        prevMetrics[0] = 0;     // Starting point.
-
-        auto hbegin = history_.begin();
-        auto hend = history_.begin() + IN / 2;
-
         constexpr size_t BUTTERFLY_SIZE = NumStates / 2;
 
-        size_t hindex = 0;
         std::array<int16_t, BUTTERFLY_SIZE> cost0;
         std::array<int16_t, BUTTERFLY_SIZE> cost1;
 
-        for (size_t i = 0; i != IN; i += 2, hindex += 1)
+        for (size_t hindex = 0; hindex != steps; ++hindex)
         {
-            int16_t s0 = in[i];
-            int16_t s1 = in[i + 1];
+            int16_t s0 = in[hindex * 2];
+            int16_t s1 = in[hindex * 2 + 1];
             cost0.fill(0);
             cost1.fill(0);
 
@@ -199,13 +251,312 @@ struct Viterbi
                     cost1[j] += std::abs(cost_[j][1] + s1);
                 }
             }
-            
+
+            decision_t decisions = 0;
             for (size_t j = 0; j != BUTTERFLY_SIZE; ++j)
             {
-                calculate_path_metric(cost0, cost1, history_[hindex], j);
+                decisions |= calculate_path_metric(cost0, cost1, j);
             }
+            hist[hindex] = decisions;
             std::swap(currMetrics, prevMetrics);
         }
+    }
+
+    /**
+     * Load prevMetrics into the int16 form used by the vector kernels.
+     *
+     * @return the offset subtracted from every metric.
+     */
+    int32_t load_metrics16(metrics16_t& metrics) const
+    {
+        int32_t offset = *std::min_element(prevMetrics.begin(), prevMetrics.end());
+        for (size_t i = 0; i != NumStates; ++i)
+        {
+            metrics[i] = std::min<int32_t>(prevMetrics[i] - offset, METRIC16_INIT);
+        }
+        return offset;
+    }
+
+    void store_metrics16(const metrics16_t& metrics, int32_t offset)
+    {
+        for (size_t i = 0; i != NumStates; ++i)
+        {
+            prevMetrics[i] = metrics[i] + offset;
+        }
+    }
+
+#if defined(OPV_SIMD_X86)
+    /**
+     * SSE2 kernel.  The 8 butterflies of the 16-state trellis are computed
+     * at once on int16 metrics.  Butterfly j feeds states 2j and 2j+1 from
+     * states j and j+8, so the new metrics are interleaved back into the
+     * low and high halves of the state vector for the next step.
+     */
+    OPV_TARGET_SSE2
+    void forward_sse2(const int8_t* in, size_t steps, decision_t* hist)
+    {
+        static_assert(NumStates == 16);
+
+        alignas(16) metrics16_t metrics;
+        int32_t offset = load_metrics16(metrics);
+
+        alignas(16) std::array<int16_t, 8> ca, cb;
+        for (size_t j = 0; j != 8; ++j)
+        {
+            ca[j] = cost_[j][0];
+            cb[j] = cost_[j][1];
+        }
+        const __m128i va = _mm_load_si128(reinterpret_cast<const __m128i*>(ca.data()));
+        const __m128i vb = _mm_load_si128(reinterpret_cast<const __m128i*>(cb.data()));
+        const __m128i zero = _mm_setzero_si128();
+
+        auto abs16 = [zero](__m128i x) { return _mm_max_epi16(x, _mm_sub_epi16(zero, x)); };
+
+        __m128i p0 = _mm_load_si128(reinterpret_cast<const __m128i*>(metrics.data()));
+        __m128i p1 = _mm_load_si128(reinterpret_cast<const __m128i*>(metrics.data() + 8));
+
+        for (size_t hindex = 0; hindex != steps; ++hindex)
+        {
+            int16_t s0 = in[hindex * 2];
+            int16_t s1 = in[hindex * 2 + 1];
+
+            // Erased (0) inputs contribute no cost.
+            const __m128i e0 = _mm_set1_epi16(s0 ? -1 : 0);
+            const __m128i e1 = _mm_set1_epi16(s1 ? -1 : 0);
+            const __m128i v0 = _mm_set1_epi16(s0);
+            const __m128i v1 = _mm_set1_epi16(s1);
+
+            __m128i c0 = _mm_add_epi16(
+                _mm_and_si128(abs16(_mm_sub_epi16(va, v0)), e0),
+                _mm_and_si128(abs16(_mm_sub_epi16(vb, v1)), e1));
+            __m128i c1 = _mm_add_epi16(
+                _mm_and_si128(abs16(_mm_add_epi16(va, v0)), e0),
+                _mm_and_si128(abs16(_mm_add_epi16(vb, v1)), e1));
+
+            __m128i m0 = _mm_adds_epi16(p0, c0);
+            __m128i m1 = _mm_adds_epi16(p0, c1);
+            __m128i m2 = _mm_adds_epi16(p1, c1);
+            __m128i m3 = _mm_adds_epi16(p1, c0);
+
+            __m128i d0 = _mm_cmpgt_epi16(m0, m2);
+            __m128i d1 = _mm_cmpgt_epi16(m1, m3);
+            uint32_t d = _mm_movemask_epi8(_mm_packs_epi16(_mm_unpacklo_epi16(d0, d1), _mm_unpackhi_epi16(d0, d1)));
+            hist[hindex] = decision_t(d);
+
+            __m128i n0 = _mm_min_epi16(m0, m2);
+            __m128i n1 = _mm_min_epi16(m1, m3);
+            __m128i lo = _mm_unpacklo_epi16(n0, n1);
+            __m128i hi = _mm_unpackhi_epi16(n0, n1);
+
+            if (hindex % RENORM_INTERVAL == RENORM_INTERVAL - 1)
+            {
+                // Renormalize.  The minimum is broadcast to all lanes without
+                // leaving the vector unit.
+                __m128i mn = _mm_min_epi16(lo, hi);
+                mn = _mm_min_epi16(mn, _mm_shuffle_epi32(mn, 0x4E));
+                mn = _mm_min_epi16(mn, _mm_shuffle_epi32(mn, 0xB1));
+                mn = _mm_min_epi16(mn, _mm_shufflehi_epi16(_mm_shufflelo_epi16(mn, 0xB1), 0xB1));
+                offset += int16_t(_mm_cvtsi128_si32(mn));
+                lo = _mm_sub_epi16(lo, mn);
+                hi = _mm_sub_epi16(hi, mn);
+            }
+            p0 = lo;
+            p1 = hi;
+        }
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(metrics.data()), p0);
+        _mm_store_si128(reinterpret_cast<__m128i*>(metrics.data() + 8), p1);
+        store_metrics16(metrics, offset);
+    }
+
+    /**
+     * AVX2 kernel.  All 16 states are updated in a single 256-bit register
+     * of int16 metrics.  The low half holds the butterflies' first outputs
+     * (states 2j) and the high half the second outputs (states 2j+1).
+     */
+    OPV_TARGET_AVX2
+    void forward_avx2(const int8_t* in, size_t steps, decision_t* hist)
+    {
+        static_assert(NumStates == 16);
+
+        alignas(32) metrics16_t metrics;
+        int32_t offset = load_metrics16(metrics);
+
+        alignas(32) std::array<int16_t, 16> ca, cb;
+        for (size_t j = 0; j != 8; ++j)
+        {
+            ca[j] = ca[j + 8] = cost_[j][0];
+            cb[j] = cb[j + 8] = cost_[j][1];
+        }
+        const __m256i va = _mm256_load_si256(reinterpret_cast<const __m256i*>(ca.data()));
+        const __m256i vb = _mm256_load_si256(reinterpret_cast<const __m256i*>(cb.data()));
+        // Negate the input in the high half to get the cost of the other branch.
+        const __m256i sign = _mm256_setr_epi16(1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+        // P = [states 0..7 | states 0..7], Q = [states 8..15 | states 8..15]
+        __m256i P = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(metrics.data())));
+        __m256i Q = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(metrics.data() + 8)));
+
+        for (size_t hindex = 0; hindex != steps; ++hindex)
+        {
+            int16_t s0 = in[hindex * 2];
+            int16_t s1 = in[hindex * 2 + 1];
+
+            const __m256i e0 = _mm256_set1_epi16(s0 ? -1 : 0);
+            const __m256i e1 = _mm256_set1_epi16(s1 ? -1 : 0);
+            const __m256i v0 = _mm256_mullo_epi16(_mm256_set1_epi16(s0), sign);
+            const __m256i v1 = _mm256_mullo_epi16(_mm256_set1_epi16(s1), sign);
+
+            // C = [cost0 | cost1], D = [cost1 | cost0]
+            __m256i C = _mm256_add_epi16(
+                _mm256_and_si256(_mm256_abs_epi16(_mm256_sub_epi16(va, v0)), e0),
+                _mm256_and_si256(_mm256_abs_epi16(_mm256_sub_epi16(vb, v1)), e1));
+            __m256i D = _mm256_permute2x128_si256(C, C, 0x01);
+
+            __m256i m = _mm256_adds_epi16(P, C);
+            __m256i n = _mm256_adds_epi16(Q, D);
+
+            __m256i g = _mm256_cmpgt_epi16(m, n);
+            __m256i gs = _mm256_permute2x128_si256(g, g, 0x01);
+            uint32_t d = _mm256_movemask_epi8(_mm256_packs_epi16(_mm256_unpacklo_epi16(g, gs), _mm256_unpackhi_epi16(g, gs))) & 0xFFFF;
+            hist[hindex] = decision_t(d);
+
+            __m256i nn = _mm256_min_epi16(m, n);
+            __m256i ns = _mm256_permute2x128_si256(nn, nn, 0x01);
+            __m256i lo = _mm256_unpacklo_epi16(nn, ns);     // low half: states 0..7
+            __m256i hi = _mm256_unpackhi_epi16(nn, ns);     // low half: states 8..15
+
+            P = _mm256_permute4x64_epi64(lo, 0x44);
+            Q = _mm256_permute4x64_epi64(hi, 0x44);
+
+            if (hindex % RENORM_INTERVAL == RENORM_INTERVAL - 1)
+            {
+                // Renormalize.
+                __m128i mn = _mm_min_epi16(_mm256_castsi256_si128(nn), _mm256_castsi256_si128(ns));
+                mn = _mm_minpos_epu16(mn);  // metrics are non-negative
+                int16_t minimum = _mm_cvtsi128_si32(mn);
+                offset += minimum;
+                __m256i vmin = _mm256_set1_epi16(minimum);
+                P = _mm256_sub_epi16(P, vmin);
+                Q = _mm256_sub_epi16(Q, vmin);
+            }
+        }
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(metrics.data()), _mm256_castsi256_si128(P));
+        _mm_store_si128(reinterpret_cast<__m128i*>(metrics.data() + 8), _mm256_castsi256_si128(Q));
+        store_metrics16(metrics, offset);
+    }
+#endif
+
+#if defined(OPV_SIMD_NEON)
+    /**
+     * NEON kernel.  Same structure as the SSE2 kernel.
+     */
+    void forward_neon(const int8_t* in, size_t steps, decision_t* hist)
+    {
+        static_assert(NumStates == 16);
+
+        alignas(16) metrics16_t metrics;
+        int32_t offset = load_metrics16(metrics);
+
+        alignas(16) std::array<int16_t, 8> ca, cb;
+        for (size_t j = 0; j != 8; ++j)
+        {
+            ca[j] = cost_[j][0];
+            cb[j] = cost_[j][1];
+        }
+        const int16x8_t va = vld1q_s16(ca.data());
+        const int16x8_t vb = vld1q_s16(cb.data());
+        const uint16x8_t bits = {1, 2, 4, 8, 16, 32, 64, 128};
+
+        int16x8_t p0 = vld1q_s16(metrics.data());
+        int16x8_t p1 = vld1q_s16(metrics.data() + 8);
+
+        for (size_t hindex = 0; hindex != steps; ++hindex)
+        {
+            int16_t s0 = in[hindex * 2];
+            int16_t s1 = in[hindex * 2 + 1];
+
+            const uint16x8_t e0 = vdupq_n_u16(s0 ? 0xFFFF : 0);
+            const uint16x8_t e1 = vdupq_n_u16(s1 ? 0xFFFF : 0);
+            const int16x8_t v0 = vdupq_n_s16(s0);
+            const int16x8_t v1 = vdupq_n_s16(s1);
+
+            int16x8_t c0 = vaddq_s16(
+                vreinterpretq_s16_u16(vandq_u16(vreinterpretq_u16_s16(vabdq_s16(va, v0)), e0)),
+                vreinterpretq_s16_u16(vandq_u16(vreinterpretq_u16_s16(vabdq_s16(vb, v1)), e1)));
+            int16x8_t c1 = vaddq_s16(
+                vreinterpretq_s16_u16(vandq_u16(vreinterpretq_u16_s16(vabsq_s16(vaddq_s16(va, v0))), e0)),
+                vreinterpretq_s16_u16(vandq_u16(vreinterpretq_u16_s16(vabsq_s16(vaddq_s16(vb, v1))), e1)));
+
+            int16x8_t m0 = vqaddq_s16(p0, c0);
+            int16x8_t m1 = vqaddq_s16(p0, c1);
+            int16x8_t m2 = vqaddq_s16(p1, c1);
+            int16x8_t m3 = vqaddq_s16(p1, c0);
+
+            uint32_t d0 = vaddvq_u16(vandq_u16(vcgtq_s16(m0, m2), bits));
+            uint32_t d1 = vaddvq_u16(vandq_u16(vcgtq_s16(m1, m3), bits));
+            hist[hindex] = decision_t(detail::spread_bits(d0) | (detail::spread_bits(d1) << 1));
+
+            int16x8x2_t n = vzipq_s16(vminq_s16(m0, m2), vminq_s16(m1, m3));
+
+            p0 = n.val[0];
+            p1 = n.val[1];
+
+            if (hindex % RENORM_INTERVAL == RENORM_INTERVAL - 1)
+            {
+                // Renormalize.
+                int16_t minimum = vminvq_s16(vminq_s16(p0, p1));
+                offset += minimum;
+                int16x8_t vmin = vdupq_n_s16(minimum);
+                p0 = vsubq_s16(p0, vmin);
+                p1 = vsubq_s16(p1, vmin);
+            }
+        }
+
+        vst1q_s16(metrics.data(), p0);
+        vst1q_s16(metrics.data() + 8, p1);
+        store_metrics16(metrics, offset);
+    }
+#endif
+
+    /**
+     * Run the add-compare-select loop over @p steps bit pairs, starting
+     * from prevMetrics, using the kernel selected by simd_.
+     *
+     * @post prevMetrics holds the final path metrics and hist[0, steps)
+     *  holds the decisions for each step.
+     */
+    void forward(const int8_t* in, size_t steps, decision_t* hist)
+    {
+        if constexpr (NumStates == 16)
+        {
+#if defined(OPV_SIMD_X86)
+            if (simd_ == SimdLevel::AVX2) return forward_avx2(in, steps, hist);
+            if (simd_ == SimdLevel::SSE2) return forward_sse2(in, steps, hist);
+#elif defined(OPV_SIMD_NEON)
+            if (simd_ == SimdLevel::NEON) return forward_neon(in, steps, hist);
+#endif
+        }
+        forward_scalar(in, steps, hist);
+    }
+
+    /**
+     * Viterbi soft decoder using LLR inputs where 0 == erasure.
+     * 
+     * @return path metric for estimating BER.
+     */
+    template <size_t IN, size_t OUT>
+    size_t decode(std::array<int8_t, IN> const& in, std::array<uint8_t, OUT>& out)
+    {
+        static_assert(std::tuple_size_v<decltype(history_)> >= IN / 2);
+
+        constexpr auto MAX_METRIC = std::numeric_limits<typename metrics_t::value_type>::max() / 2;
+
+        prevMetrics.fill(MAX_METRIC);
+        prevMetrics[0] = 0;     // Starting point.
+
+        forward(in.data(), IN / 2, history_.data());
 
         // Find starting point. Should be 0 for properly flushed CCs.
         // However, 0 may not be the path with the fewest errors.
@@ -223,16 +574,12 @@ struct Viterbi
 
         size_t cost = std::round(min_cost / float(detail::llr_limit<LLR_>()));
 
-        // Do chainback.
-        auto oit = std::rbegin(out);
-        auto hit = std::make_reverse_iterator(hend);        // rbegin
-        auto hrend = std::make_reverse_iterator(hbegin);    // rend
+        // Do chainback.  Only the first OUT steps produce output; the rest are flush bits.
         size_t next_element = min_element;
-        size_t index = IN / 2;
-        while (oit != std::rend(out) && hit != hrend)
+        for (size_t index = IN / 2; index != 0; --index)
         {
-            auto v = (*hit++)[next_element];
-            if (index-- <= OUT) *oit++ = next_element & 1;
+            auto v = (history_[index - 1] >> next_element) & 1;
+            if (index <= OUT) out[index - 1] = next_element & 1;
             next_element = prevState_[next_element][v];
         }
 
@@ -240,4 +587,202 @@ struct Viterbi
     }
 };
 
+/**
+ * Streaming soft decision Viterbi decoder with a fixed traceback depth.
+ *
+ * LLRs (0 == erasure) can be supplied in pieces of any size.  Once depth +
+ * BLOCK steps are undecided, a traceback from the best state decides the
+ * oldest BLOCK bits.  They are packed MSB first into bytes and passed to
+ * the callback, so decoded data trails the input by depth to depth + BLOCK
+ * bits instead of by a whole frame.  A depth of about 5 * K is normally
+ * enough for the survivor paths to have merged.
+ *
+ * The input must be the code stream in transmission order, so this is for
+ * non-interleaved test modes.  OPV stream frames are interleaved over the
+ * whole frame: the first payload LLR is only known once the last symbol of
+ * the frame has arrived.  By then Viterbi::decode() decodes the frame in
+ * about 12 us, with a traceback over the whole frame from the flushed end
+ * state.  This decoder gives the same bits only with a depth of 64 or more,
+ * and takes 1.5 to 2 times as long, so OPVFrameDecoder does not use it.
+ */
+template <typename Trellis_, size_t LLR_ = 2>
+struct StreamingViterbi
+{
+    using viterbi_t = Viterbi<Trellis_, LLR_>;
+    using decision_t = typename viterbi_t::decision_t;
+
+    /**
+     * Receives decoded bytes.  The data is only valid during the call.
+     */
+    using callback_t = std::function<void(const uint8_t*, size_t)>;
+
+    static constexpr size_t n = Trellis_::n;
+    static constexpr size_t BLOCK = 64;         // Bits decided per traceback.
+    static constexpr size_t MAX_DEPTH = 256;
+    static constexpr size_t HISTORY_SIZE = MAX_DEPTH + BLOCK;
+
+    static_assert(BLOCK % 8 == 0);
+
+    viterbi_t viterbi_;
+    callback_t callback_;
+    size_t depth_;
+
+    std::array<decision_t, HISTORY_SIZE> history_;  // Circular, starting at head_.
+    size_t head_ = 0;           // Oldest undecided step.
+    size_t pending_ = 0;        // Number of undecided steps.
+    int64_t offset_ = 0;        // Sum of the minimums removed from the path metrics.
+
+    std::array<int8_t, n> partial_;     // LLRs for an incomplete step.
+    size_t partial_count_ = 0;
+
+    std::array<uint8_t, HISTORY_SIZE> bits_;
+    std::array<uint8_t, HISTORY_SIZE / 8 + 1> bytes_;
+    uint8_t byte_ = 0;          // Output byte being assembled.
+    size_t bit_count_ = 0;
+
+    /**
+     * @param depth is the traceback depth in bits, at most MAX_DEPTH.
+     */
+    StreamingViterbi(Trellis_ trellis, callback_t callback, size_t depth = 5 * Trellis_::K)
+    : viterbi_(trellis)
+    , callback_(callback)
+    , depth_(std::min(depth, MAX_DEPTH))
+    {
+        reset();
+    }
+
+    /**
+     * Start a new code stream from state 0.  Undecided bits are discarded.
+     */
+    void reset()
+    {
+        viterbi_.prevMetrics.fill(std::numeric_limits<int32_t>::max() / 2);
+        viterbi_.prevMetrics[0] = 0;
+        head_ = 0;
+        pending_ = 0;
+        offset_ = 0;
+        partial_count_ = 0;
+        byte_ = 0;
+        bit_count_ = 0;
+    }
+
+    /**
+     * Add @p len LLRs to the stream.  The callback is called for each
+     * block of bits that is decided.
+     */
+    void decode(const int8_t* in, size_t len)
+    {
+        if (partial_count_ != 0)
+        {
+            while (partial_count_ != n && len != 0)
+            {
+                partial_[partial_count_++] = *in++;
+                --len;
+            }
+            if (partial_count_ != n) return;
+            partial_count_ = 0;
+            run(partial_.data(), 1);
+        }
+
+        size_t steps = len / n;
+        while (steps != 0)
+        {
+            size_t count = std::min(steps, depth_ + BLOCK - pending_);
+            run(in, count);
+            in += count * n;
+            steps -= count;
+        }
+
+        for (size_t i = 0; i != len % n; ++i)
+        {
+            partial_[partial_count_++] = in[i];
+        }
+    }
+
+    /**
+     * End the code stream.  All undecided bits except the last @p tail,
+     * which are the encoder flush bits, are passed to the callback.  A
+     * final partial byte is padded with zeros.  The decoder is then reset.
+     *
+     * @return path metric for estimating BER, as for Viterbi::decode().
+     */
+    size_t flush(size_t tail = Trellis_::K)
+    {
+        auto best = best_state();
+        size_t cost = std::round((offset_ + viterbi_.prevMetrics[best]) / float(detail::llr_limit<LLR_>()));
+
+        traceback(best, pending_ - std::min(tail, pending_));
+        if (bit_count_ != 0)
+        {
+            uint8_t last = byte_ << (8 - bit_count_);
+            callback_(&last, 1);
+        }
+
+        reset();
+        return cost;
+    }
+
+private:
+
+    size_t best_state() const
+    {
+        auto& metrics = viterbi_.prevMetrics;
+        return std::min_element(metrics.begin(), metrics.end()) - metrics.begin();
+    }
+
+    /**
+     * Run the forward pass over @p steps steps, which must fit in the
+     * history, and decide a block if there are now enough pending.
+     */
+    void run(const int8_t* in, size_t steps)
+    {
+        size_t tail = (head_ + pending_) % HISTORY_SIZE;
+        size_t first = std::min(steps, HISTORY_SIZE - tail);
+        viterbi_.forward(in, first, history_.data() + tail);
+        if (first != steps)
+        {
+            viterbi_.forward(in + first * n, steps - first, history_.data());
+        }
+        pending_ += steps;
+
+        // Keep the int32 path metrics bounded on an endless stream.
+        auto& metrics = viterbi_.prevMetrics;
+        int32_t minimum = *std::min_element(metrics.begin(), metrics.end());
+        for (auto& m : metrics) m -= minimum;
+        offset_ += minimum;
+
+        if (pending_ == depth_ + BLOCK) traceback(best_state(), BLOCK);
+    }
+
+    /**
+     * Trace back from @p state through all pending steps and emit the
+     * oldest @p count bits.
+     */
+    void traceback(size_t state, size_t count)
+    {
+        for (size_t i = pending_; i != 0; --i)
+        {
+            auto decisions = history_[(head_ + i - 1) % HISTORY_SIZE];
+            if (i <= count) bits_[i - 1] = state & 1;
+            state = viterbi_.prevState_[state][(decisions >> state) & 1];
+        }
+
+        size_t nbytes = 0;
+        for (size_t i = 0; i != count; ++i)
+        {
+            byte_ = (byte_ << 1) | bits_[i];
+            if (++bit_count_ == 8)
+            {
+                bytes_[nbytes++] = byte_;
+                byte_ = 0;
+                bit_count_ = 0;
+            }
+        }
+        if (nbytes != 0) callback_(bytes_.data(), nbytes);
+
+        head_ = (head_ + count) % HISTORY_SIZE;
+        pending_ -= count;
+    }
+};
+
 } // mobilinkd
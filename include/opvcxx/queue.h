@@ -4,6 +4,9 @@
 #include <list>
 #include <iterator>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <condition_variable>
 #include <mutex>
@@ -248,4 +251,379 @@ public:
     }
 };
 
+/**
+ * A bounded queue for exactly one producer thread and one consumer thread.
+ *
+ * Elements are kept in a ring.  Each side owns one index and publishes it
+ * with an atomic store, so a put or get that does not have to wait takes
+ * no lock and allocates nothing.  The mutex and condition variables are
+ * only used to sleep when the ring is empty or full.  put_n() and get_n()
+ * move a whole block, such as an audio frame, per index update.
+ *
+ * Closing works as for queue: put fails once the queue is closed, and get
+ * returns the remaining elements before it fails.
+ *
+ * stats() reports the deepest the queue has been and how often, and for
+ * how long, each side had to wait.  These are for sizing the queue and
+ * finding the slow side of a pipeline.
+ */
+template <typename T, size_t SIZE>
+class spsc_queue
+{
+private:
+
+    using mutex_type = std::mutex;
+    using lock_type = std::unique_lock<mutex_type>;
+    using guard_type = std::lock_guard<mutex_type>;
+    using clock_type = std::chrono::steady_clock;
+
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::array<T, SIZE> buffer_;
+
+    // The indices count elements since construction and are reduced
+    // modulo SIZE to address the ring.  Each is on its own cache line
+    // with the owner's copy of the other index.
+    alignas(CACHE_LINE) std::atomic<size_t> write_{0};
+    size_t read_cache_ = 0;     // producer's view of read_
+    alignas(CACHE_LINE) std::atomic<size_t> read_{0};
+    size_t write_cache_ = 0;    // consumer's view of write_
+
+    alignas(CACHE_LINE) std::atomic<bool> closed_{false};
+    std::atomic<bool> reader_waiting_{false};
+    std::atomic<bool> writer_waiting_{false};
+    mutex_type mutex_;
+    std::condition_variable full_;
+    std::condition_variable empty_;
+
+    // Statistics.  The waits are only counted on the slow path.
+    std::atomic<size_t> max_size_{0};       // written by the producer
+    std::atomic<size_t> put_waits_{0};
+    std::atomic<size_t> get_waits_{0};
+    std::atomic<int64_t> put_wait_ns_{0};
+    std::atomic<int64_t> get_wait_ns_{0};
+
+    spsc_queue(spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    template <class Rep, class Period>
+    static clock_type::time_point deadline(std::chrono::duration<Rep, Period> timeout)
+    {
+        auto now = clock_type::now();
+        if (std::chrono::duration<double>(timeout) >= std::chrono::duration<double>(clock_type::time_point::max() - now))
+        {
+            return clock_type::time_point::max();
+        }
+        return now + std::chrono::duration_cast<clock_type::duration>(timeout);
+    }
+
+    // Count one wait on the slow path, which started at @p start.
+    static void count_wait(std::atomic<size_t>& waits, std::atomic<int64_t>& wait_ns, clock_type::time_point start)
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start);
+        waits.fetch_add(1, std::memory_order_relaxed);
+        wait_ns.fetch_add(elapsed.count(), std::memory_order_relaxed);
+    }
+
+    // Returns false on timeout.
+    static bool wait(std::condition_variable& cv, lock_type& lock, clock_type::time_point when)
+    {
+        if (when == clock_type::time_point::max())
+        {
+            // The caller checks its condition again after any wakeup.
+            cv.wait_for(lock, std::chrono::hours(1));
+            return true;
+        }
+        return cv.wait_until(lock, when) != std::cv_status::timeout;
+    }
+
+    /**
+     * Wait until there is at least one element to read at @p read.
+     * @return the number of elements available, or 0 on timeout or if
+     *  the queue is closed and empty.
+     */
+    size_t readable(size_t read, clock_type::time_point when)
+    {
+        if (write_cache_ == read) write_cache_ = write_.load(std::memory_order_acquire);
+        if (write_cache_ != read) return write_cache_ - read;
+
+        const auto start = clock_type::now();
+        lock_type lock(mutex_);
+        reader_waiting_.store(true);
+        while (true)
+        {
+            // The producer stores write_ before closed_.
+            bool closed = closed_.load();
+            write_cache_ = write_.load();
+            if (write_cache_ != read || closed || !wait(empty_, lock, when)) break;
+        }
+        reader_waiting_.store(false);
+        count_wait(get_waits_, get_wait_ns_, start);
+        return write_cache_ - read;
+    }
+
+    /**
+     * Wait until there is room for at least one element at @p write.
+     * @return the free space, or 0 on timeout or if the queue is closed.
+     */
+    size_t writable(size_t write, clock_type::time_point when)
+    {
+        if (closed_.load(std::memory_order_relaxed)) return 0;
+        if (write - read_cache_ == SIZE) read_cache_ = read_.load(std::memory_order_acquire);
+        if (write - read_cache_ != SIZE) return SIZE - (write - read_cache_);
+        if (when == clock_type::time_point::min()) return 0;
+
+        const auto start = clock_type::now();
+        lock_type lock(mutex_);
+        writer_waiting_.store(true);
+        while (true)
+        {
+            read_cache_ = read_.load();
+            if (write - read_cache_ != SIZE || closed_.load() || !wait(full_, lock, when)) break;
+        }
+        writer_waiting_.store(false);
+        count_wait(put_waits_, put_wait_ns_, start);
+        return closed_.load() ? 0 : SIZE - (write - read_cache_);
+    }
+
+    // The waiting flag is stored before the waiter checks the index, and
+    // the index is stored before the flag is checked here, so one of the
+    // two sides always sees the other.
+    void publish_write(size_t write)
+    {
+        size_t size = write - read_.load(std::memory_order_relaxed);
+        if (size > max_size_.load(std::memory_order_relaxed)) max_size_.store(size, std::memory_order_relaxed);
+
+        write_.store(write);
+        if (reader_waiting_.load())
+        {
+            guard_type lock(mutex_);
+            empty_.notify_one();
+        }
+    }
+
+    void publish_read(size_t read)
+    {
+        read_.store(read);
+        if (writer_waiting_.load())
+        {
+            guard_type lock(mutex_);
+            full_.notify_one();
+        }
+    }
+
+public:
+
+    static constexpr auto forever = std::chrono::seconds::max();
+
+    /// The data type stored in the queue.
+    using value_type = T;
+
+    /// A reference to an element stored in the queue.
+    using reference = value_type&;
+
+    /// A const reference to an element stored in the queue.
+    using const_reference = value_type const&;
+
+    /// Queue statistics since construction.
+    struct stats_t
+    {
+        size_t max_size = 0;    // most items in the queue after a put
+        size_t put_waits = 0;   // puts that found the queue full and waited
+        size_t get_waits = 0;   // gets that found the queue empty and waited
+        std::chrono::nanoseconds put_wait_time{0};
+        std::chrono::nanoseconds get_wait_time{0};
+    };
+
+    spsc_queue()
+    {}
+
+    /**
+     * Get the next item in the queue.  Consumer thread only.
+     *
+     * @param[out] val is an object into which the object will be moved.
+     * @param[in] when is the time to give up waiting for an item.
+     *
+     * @return true if a value was returned, otherwise false.
+     *
+     * @note The return value me be false if either the timeout expires
+     *  or the queue is closed and empty.
+     */
+    template<class Clock>
+    bool get_until(reference val, std::chrono::time_point<Clock> when)
+    {
+        return get(val, when - Clock::now());
+    }
+
+    /**
+     * Get the next item in the queue.  Consumer thread only.
+     *
+     * @param[out] val is an object into which the object will be moved.
+     * @param[in] timeout is the duration to wait for an item to appear
+     *  in the queue (default is forever, duration::max()).
+     *
+     * @return true if a value was returned, otherwise false.
+     */
+    template<class Rep = int64_t, class Period = std::ratio<1>>
+    bool get(reference val, std::chrono::duration<Rep, Period> timeout = std::chrono::duration<Rep, Period>::max())
+    {
+        size_t read = read_.load(std::memory_order_relaxed);
+        if (!readable(read, deadline(timeout))) return false;
+
+        val = std::move(buffer_[read % SIZE]);
+        publish_read(read + 1);
+        return true;
+    }
+
+    /**
+     * Get up to @p count items.  Consumer thread only.  This waits until
+     * all of them have been read, the timeout expires, or the queue is
+     * closed and empty.
+     *
+     * @return the number of items read.
+     */
+    template<class Rep = int64_t, class Period = std::ratio<1>>
+    size_t get_n(T* data, size_t count, std::chrono::duration<Rep, Period> timeout = std::chrono::duration<Rep, Period>::max())
+    {
+        const auto when = deadline(timeout);
+        size_t read = read_.load(std::memory_order_relaxed);
+        size_t done = 0;
+        while (done != count)
+        {
+            size_t n = std::min(readable(read, when), count - done);
+            if (n == 0) break;
+
+            // At most two pieces, either side of the end of the ring.
+            size_t pos = read % SIZE;
+            size_t first = std::min(n, SIZE - pos);
+            std::move(buffer_.begin() + pos, buffer_.begin() + pos + first, data + done);
+            std::move(buffer_.begin(), buffer_.begin() + (n - first), data + done + first);
+
+            read += n;
+            done += n;
+            publish_read(read);
+        }
+        return done;
+    }
+
+    /**
+     * Put an item on the queue.  Producer thread only.
+     *
+     * @param[in] val is the element to be appended to the queue.
+     * @param[in] timeout is the duration to wait until queue there is room
+     *  for more items on the queue (default is forever -- duration::max()).
+     *
+     * @return true if a value was put on the queue, otherwise false.
+     *
+     * @note The return value me be false if either the timeout expires
+     *  or the queue is closed.
+     */
+    template<typename U, class Rep = int64_t, class Period = std::ratio<1>>
+    bool put(U&& val, std::chrono::duration<Rep, Period> timeout = std::chrono::duration<Rep, Period>::max())
+    {
+        size_t write = write_.load(std::memory_order_relaxed);
+        auto when = timeout.count() == 0 ? clock_type::time_point::min() : deadline(timeout);
+        if (!writable(write, when)) return false;
+
+        buffer_[write % SIZE] = std::forward<U>(val);
+        publish_write(write + 1);
+        return true;
+    }
+
+    /**
+     * Put @p count items on the queue.  Producer thread only.  This waits
+     * for room until all of them have been put, the timeout expires, or
+     * the queue is closed.
+     *
+     * @return the number of items put.
+     */
+    template<class Rep = int64_t, class Period = std::ratio<1>>
+    size_t put_n(const T* data, size_t count, std::chrono::duration<Rep, Period> timeout = std::chrono::duration<Rep, Period>::max())
+    {
+        const auto when = timeout.count() == 0 ? clock_type::time_point::min() : deadline(timeout);
+        size_t write = write_.load(std::memory_order_relaxed);
+        size_t done = 0;
+        while (done != count)
+        {
+            size_t n = std::min(writable(write, when), count - done);
+            if (n == 0) break;
+
+            size_t pos = write % SIZE;
+            size_t first = std::min(n, SIZE - pos);
+            std::copy(data + done, data + done + first, buffer_.begin() + pos);
+            std::copy(data + done + first, data + done + n, buffer_.begin());
+
+            write += n;
+            done += n;
+            publish_write(write);
+        }
+        return done;
+    }
+
+    /**
+     * Stop accepting items.  Items already in the queue can still be read.
+     */
+    void close()
+    {
+        closed_.store(true);
+
+        guard_type lock(mutex_);
+        full_.notify_all();
+        empty_.notify_all();
+    }
+
+    bool is_open() const
+    {
+        return !closed_.load();
+    }
+
+    /**
+     * @return true if the queue is closed and all of its items were read.
+     */
+    bool is_closed() const
+    {
+        return closed_.load() && empty();
+    }
+
+    /**
+     *  @return the number of items in the queue.
+     */
+    size_t size() const
+    {
+        size_t read = read_.load(std::memory_order_acquire);
+        return write_.load(std::memory_order_acquire) - read;
+    }
+
+    /**
+     *  @return true if there are no items in the queue.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     *  @return the capacity of the queue.
+     */
+    static constexpr size_t capacity()
+    {
+        return SIZE;
+    }
+
+    /**
+     * @return the statistics so far.  This may be called from any thread;
+     *  the counters are not read as one snapshot.
+     */
+    stats_t stats() const
+    {
+        stats_t result;
+        result.max_size = max_size_.load(std::memory_order_relaxed);
+        result.put_waits = put_waits_.load(std::memory_order_relaxed);
+        result.get_waits = get_waits_.load(std::memory_order_relaxed);
+        result.put_wait_time = std::chrono::nanoseconds(put_wait_ns_.load(std::memory_order_relaxed));
+        result.get_wait_time = std::chrono::nanoseconds(get_wait_ns_.load(std::memory_order_relaxed));
+        return result;
+    }
+};
+
 } // mobilinkd
@@ -0,0 +1,157 @@
+#include "BatchViterbi.h"
+#include "Viterbi.h"
+#include "Trellis.h"
+#include "Numerology.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class BatchViterbiTest : public ::testing::Test {
+ protected:
+  using input_t = std::array<int8_t, stream_type3_payload_size>;
+  using output_t = std::array<uint8_t, stream_frame_payload_size>;
+
+  Trellis<4,2> trellis{makeTrellis<4, 2>({ConvolutionPolyA,ConvolutionPolyB})};
+
+  void SetUp() override {}
+
+  static void randomize(input_t& frame, bool full_range)
+  {
+      if (full_range) for (auto& e : frame) e = rand() % 256 - 128;
+      else for (auto& e : frame) e = rand() % 15 - 7;
+  }
+};
+
+TEST_F(BatchViterbiTest, matches_viterbi)
+{
+    Viterbi<decltype(trellis), 4> viterbi(trellis);
+    BatchViterbi<decltype(trellis), 4> batch(trellis);
+
+    std::vector<input_t> frames(16);
+    std::vector<output_t> outputs(16);
+    output_t expected;
+
+    std::vector<SimdLevel> levels = {SimdLevel::SCALAR};
+    if (simd_level() == SimdLevel::AVX2) levels.push_back(SimdLevel::AVX2);
+
+    srand(41);
+    for (auto level : levels)
+    {
+        batch.simd_ = level;
+        for (size_t round = 0; round != 4; ++round)
+        {
+            std::array<const input_t*, 16> in;
+            std::array<output_t*, 16> out;
+            for (size_t i = 0; i != 16; ++i)
+            {
+                randomize(frames[i], round & 1);
+                in[i] = &frames[i];
+                out[i] = &outputs[i];
+            }
+
+            auto cost = batch.decode(in, out);
+
+            for (size_t i = 0; i != 16; ++i)
+            {
+                auto expected_cost = viterbi.decode(frames[i], expected);
+                EXPECT_EQ(cost[i], expected_cost) << "level " << int(level) << " lane " << i;
+                EXPECT_EQ(outputs[i], expected) << "level " << int(level) << " lane " << i;
+            }
+        }
+    }
+}
+
+TEST_F(BatchViterbiTest, partial_batch)
+{
+    Viterbi<decltype(trellis), 4> viterbi(trellis);
+    BatchViterbi<decltype(trellis), 4> batch(trellis);
+
+    input_t frame;
+    output_t output, expected;
+    srand(43);
+    randomize(frame, false);
+
+    std::array<const input_t*, 16> in{};
+    std::array<output_t*, 16> out{};
+    in[5] = &frame;
+    out[5] = &output;
+
+    auto cost = batch.decode(in, out);
+    EXPECT_EQ(cost[5], viterbi.decode(frame, expected));
+    EXPECT_EQ(output, expected);
+    EXPECT_EQ(cost[0], 0);
+}
+
+TEST_F(BatchViterbiTest, scheduler)
+{
+    Viterbi<decltype(trellis), 4> viterbi(trellis);
+    BatchViterbiScheduler<decltype(trellis), 4, stream_type3_payload_size, stream_frame_payload_size> scheduler(trellis);
+
+    constexpr size_t FRAMES = 37;
+    std::vector<input_t> frames(FRAMES);
+    std::vector<size_t> order;
+
+    srand(47);
+    for (size_t i = 0; i != FRAMES; ++i)
+    {
+        randomize(frames[i], false);
+        scheduler.submit(frames[i], [&, i](const output_t& output, size_t cost) {
+            output_t expected;
+            EXPECT_EQ(cost, viterbi.decode(frames[i], expected));
+            EXPECT_EQ(output, expected);
+            order.push_back(i);
+        });
+    }
+
+    EXPECT_EQ(order.size(), 32);
+    EXPECT_EQ(scheduler.pending(), 5);
+    scheduler.flush();
+    EXPECT_EQ(scheduler.pending(), 0);
+    ASSERT_EQ(order.size(), FRAMES);
+    for (size_t i = 0; i != FRAMES; ++i) EXPECT_EQ(order[i], i);
+}
+
+TEST_F(BatchViterbiTest, throughput)
+{
+    Viterbi<decltype(trellis), 4> viterbi(trellis);
+    BatchViterbi<decltype(trellis), 4> batch(trellis);
+
+    std::vector<input_t> frames(16);
+    std::vector<output_t> expected(16);
+    std::vector<size_t> expected_cost(16);
+    std::vector<output_t> outputs(16);
+    std::array<const input_t*, 16> in;
+    std::array<output_t*, 16> out;
+    srand(53);
+    for (size_t i = 0; i != 16; ++i)
+    {
+        randomize(frames[i], false);
+        in[i] = &frames[i];
+        out[i] = &outputs[i];
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i != 16; ++i) expected_cost[i] = viterbi.decode(frames[i], expected[i]);
+    auto mid = std::chrono::high_resolution_clock::now();
+    auto cost = batch.decode(in, out);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "16 frames: single " << (mid - start).count() << "ns, batch " << (end - mid).count() << "ns" << std::endl;
+
+    for (size_t i = 0; i != 16; ++i)
+    {
+        EXPECT_EQ(cost[i], expected_cost[i]) << "lane " << i;
+        EXPECT_EQ(outputs[i], expected[i]) << "lane " << i;
+    }
+}
@@ -4,6 +4,8 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <random>
+#include <vector>
 
 // make CXXFLAGS="$(pkg-config --cflags gtest) $(pkg-config --libs gtest) -I. -O3 -std=c++17" tests/SlidingDFTTest
 
@@ -114,4 +116,178 @@ TEST_F(CorrelatorTest, all_phases)
         EXPECT_EQ(int(cr.sample_index()), expected[p]);
     }
 }
-#endif
\ No newline at end of file
+#endif
+
+TEST_F(CorrelatorTest, sync_search_matches_correlator)
+{
+    using search_t = mobilinkd::SyncSearch<float>;
+    const search_t::sync_t sync_word = {-3,-3,-3,-3,+3,+3,-3,+3};
+
+    std::vector<float> input(1000);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    for (auto& x : input) x = uniform(rng);
+
+    std::vector<float> expected(input.size() - search_t::SPAN);
+    auto search = search_t(sync_word, 32.f);
+    search.correlate(input.data(), input.size(), expected.data());
+
+    auto correlator = mobilinkd::Correlator<float>();
+    for (size_t t = 0; t != input.size(); ++t)
+    {
+        correlator.sample(input[t]);
+        if (t < search_t::SYMBOLS * search_t::SAMPLES_PER_SYMBOL) continue;
+        EXPECT_NEAR(correlator.correlate(sync_word), expected[t - search_t::SPAN], 1e-4);
+    }
+}
+
+TEST_F(CorrelatorTest, sync_search)
+{
+    using search_t = mobilinkd::SyncSearch<float>;
+    const search_t::sync_t sync_word = {-3,-3,-3,-3,+3,+3,-3,+3};
+
+    // Frames of a sync word and 200 random symbols.  Symbols are 10
+    // samples apart with a linear pulse between them, and the first
+    // symbol is at sample 3.
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int> symbol(0, 3);
+    std::normal_distribution<float> noise(0, 0.1);
+    std::vector<int8_t> symbols;
+    std::vector<size_t> expected;
+    for (size_t i = 0; i != 100; ++i) symbols.push_back(symbol(rng) * 2 - 3);
+    for (size_t f = 0; f != 5; ++f)
+    {
+        expected.push_back(3 + symbols.size() * 10);
+        symbols.insert(symbols.end(), sync_word.begin(), sync_word.end());
+        for (size_t i = 0; i != 200; ++i) symbols.push_back(symbol(rng) * 2 - 3);
+    }
+
+    std::vector<float> input(3, 0.f);
+    for (size_t i = 0; i + 1 < symbols.size(); ++i)
+    {
+        for (int j = 0; j != 10; ++j)
+        {
+            input.push_back((symbols[i] * (10 - j) + symbols[i + 1] * j) / 30.f + noise(rng));
+        }
+    }
+
+    // The mean magnitude of this signal is higher than a real one.
+    auto search = search_t(sync_word, 38.f);
+    auto candidates = search(input.data(), input.size());
+
+    ASSERT_EQ(candidates.size(), expected.size());
+    for (size_t i = 0; i != expected.size(); ++i)
+    {
+        // Repeated symbols flatten the peak; noise can move it a sample.
+        EXPECT_NEAR(double(candidates[i].offset), double(expected[i]), 1.0);
+        EXPECT_EQ(candidates[i].phase(), candidates[i].offset % 10);
+        EXPECT_GT(candidates[i].value, 0.f);
+    }
+}
+
+TEST_F(CorrelatorTest, sync_search_preamble_and_stream)
+{
+    using search_t = mobilinkd::SyncSearch<float, 2>;
+    const search_t::sync_t preamble = {+3,-3,+3,-3,+3,-3,+3,-3};
+    const search_t::sync_t stream = {-3,-3,-3,-3,+3,+3,-3,+3};
+
+    // 48 symbols of preamble, then frames of a STREAM sync word and 200
+    // random symbols, built as in sync_search.  The random symbols of this
+    // seed do not happen to contain the preamble.
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> symbol(0, 3);
+    std::normal_distribution<float> noise(0, 0.1);
+    std::vector<int8_t> symbols;
+    std::vector<size_t> expected;
+    for (size_t i = 0; i != 48; ++i) symbols.push_back(preamble[i % preamble.size()]);
+    for (size_t f = 0; f != 4; ++f)
+    {
+        expected.push_back(3 + symbols.size() * 10);
+        symbols.insert(symbols.end(), stream.begin(), stream.end());
+        for (size_t i = 0; i != 200; ++i) symbols.push_back(symbol(rng) * 2 - 3);
+    }
+
+    std::vector<float> input(3, 0.f);
+    for (size_t i = 0; i + 1 < symbols.size(); ++i)
+    {
+        for (int j = 0; j != 10; ++j)
+        {
+            input.push_back((symbols[i] * (10 - j) + symbols[i + 1] * j) / 30.f + noise(rng));
+        }
+    }
+
+    auto search = search_t({{{preamble, 38.f}, {stream, 38.f}}});
+    auto candidates = search(input.data(), input.size());
+
+    std::vector<size_t> found;
+    size_t preambles = 0;
+    for (size_t i = 0; i != candidates.size(); ++i)
+    {
+        if (i != 0)
+        {
+            EXPECT_LE(candidates[i - 1].offset, candidates[i].offset);
+        }
+        if (candidates[i].word == 1)
+        {
+            found.push_back(candidates[i].offset);
+        }
+        else
+        {
+            // Every other symbol of the preamble, at the same phase.
+            EXPECT_LT(candidates[i].offset, expected[0]);
+            EXPECT_EQ(candidates[i].phase(), 3u);
+            ++preambles;
+        }
+    }
+    EXPECT_GE(preambles, 10u);
+
+    ASSERT_EQ(found.size(), expected.size());
+    for (size_t i = 0; i != expected.size(); ++i)
+    {
+        EXPECT_NEAR(double(found[i]), double(expected[i]), 1.0);
+    }
+}
+
+TEST_F(CorrelatorTest, correlate_by_phase)
+{
+    using correlator_t = mobilinkd::Correlator<float>;
+    const correlator_t::sync_t preamble = {+3,-3,+3,-3,+3,-3,+3,-3};
+    const correlator_t::sync_t stream = {-3,-3,-3,-3,+3,+3,-3,+3};
+
+    std::vector<float> input(500);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    for (auto& x : input) x = uniform(rng);
+
+    auto correlator = correlator_t();
+    for (size_t t = 0; t != input.size(); ++t)
+    {
+        correlator.sample(input[t]);
+        EXPECT_EQ(correlator.index(), t % 10);
+        EXPECT_EQ(correlator.next_index(), (t + 1) % 10);
+        if (t < 80) continue;
+
+        // The newest sample and the 7 before it at the same phase, summed
+        // oldest first as the correlator always has.
+        float expected_preamble = 0;
+        float expected_stream = 0;
+        for (size_t i = 0; i != 8; ++i)
+        {
+            expected_preamble += preamble[i] * input[t - 70 + i * 10];
+            expected_stream += stream[i] * input[t - 70 + i * 10];
+        }
+
+        auto [p, s] = correlator.correlate(std::array{preamble, stream});
+        EXPECT_EQ(p, expected_preamble);
+        EXPECT_EQ(s, expected_stream);
+        EXPECT_EQ(correlator.correlate(stream), s);
+
+        std::vector<float> samples;
+        correlator.apply([&samples](float x) { samples.push_back(x); }, t % 10);
+        std::sort(samples.begin(), samples.end());
+        std::vector<float> expected_samples;
+        for (size_t i = 0; i != 8; ++i) expected_samples.push_back(input[t - 70 + i * 10]);
+        std::sort(expected_samples.begin(), expected_samples.end());
+        EXPECT_EQ(samples, expected_samples);
+    }
+}
@@ -1,9 +1,14 @@
 #include "DataCarrierDetect.h"
+#include "FirFilter.h"
+#include "OPVDemodulator.h"
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
 #include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
 
 
 int main(int argc, char **argv) {
@@ -51,3 +56,160 @@ TEST_F(DataCarrierDetectTest, dcd_off)
 
     EXPECT_FALSE(dcd.dcd());
 }
+
+TEST_F(DataCarrierDetectTest, block_dcd)
+{
+    constexpr std::array<float, 24> input = {1,1,1,1,1,1,1,1,1,1,1,1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
+
+    auto dcd = mobilinkd::BlockDataCarrierDetect<float, 48000, 1000>(2000,3000,1.0,5.0);
+    dcd(input.data(), input.size());
+    dcd(input.data(), input.size());
+    dcd(input.data(), input.size());
+
+    dcd.update();
+
+    EXPECT_TRUE(dcd.dcd());
+}
+
+TEST_F(DataCarrierDetectTest, block_dcd_off)
+{
+    constexpr std::array<float, 16> input = {1,1,1,1,1,1,1,1,-1,-1,-1,-1,-1,-1,-1,-1};
+
+    auto dcd = mobilinkd::BlockDataCarrierDetect<float, 48000, 1000>(2000,3000, 0.1, 1.0);
+    dcd(input.data(), input.size());
+    dcd(input.data(), input.size());
+    dcd(input.data(), input.size());
+    dcd(input.data(), input.size());
+
+    dcd.update();
+
+    EXPECT_FALSE(dcd.dcd());
+}
+
+TEST_F(DataCarrierDetectTest, block_matches_sample)
+{
+    // Block boundaries do not line up with the DFT blocks.
+    std::vector<float> input(1000);
+    srand(3);
+    for (auto& x : input) x = (rand() % 2001 - 1000) / 1000.0;
+
+    auto expected = mobilinkd::BlockDataCarrierDetect<float, 48000, 1000>(2000,3000,1.0,5.0);
+    for (auto x : input) expected(x);
+    expected.update();
+
+    auto dcd = mobilinkd::BlockDataCarrierDetect<float, 48000, 1000>(2000,3000,1.0,5.0);
+    for (size_t i = 0; i < input.size(); i += 70)
+    {
+        dcd(input.data() + i, std::min<size_t>(70, input.size() - i));
+    }
+    dcd.update();
+
+    EXPECT_NEAR(dcd.level(), expected.level(), expected.level() * 1e-4);
+}
+
+TEST_F(DataCarrierDetectTest, squelch)
+{
+    std::vector<int16_t> noise(2000);
+    srand(5);
+    for (auto& x : noise) x = rand() % 2001 - 1000;
+
+    // A band limited signal crosses zero every 10 samples.
+    std::vector<int16_t> signal(2000);
+    for (size_t i = 0; i != signal.size(); ++i) signal[i] = (i / 10) % 2 ? -1000 : 1000;
+
+    auto squelch = mobilinkd::ZeroCrossingSquelch<float>();
+    squelch(noise.data(), noise.size());
+    EXPECT_TRUE(squelch.update());
+    squelch(signal.data(), signal.size());
+    EXPECT_FALSE(squelch.update());
+    squelch(noise.data(), noise.size());
+    EXPECT_TRUE(squelch.update());
+}
+
+TEST_F(DataCarrierDetectTest, squelch_int_matches_float)
+{
+    std::vector<int16_t> input(1000);
+    srand(7);
+    for (auto& x : input) x = rand() % 21 - 10;     // includes zeros
+
+    std::vector<float> scaled(input.size());
+    std::transform(input.begin(), input.end(), scaled.begin(), [](int16_t x) { return x * -0.001f; });
+
+    auto expected = mobilinkd::ZeroCrossingSquelch<float>();
+    auto squelch = mobilinkd::ZeroCrossingSquelch<float>();
+    for (size_t i = 0; i < input.size(); i += 70)
+    {
+        const size_t n = std::min<size_t>(70, input.size() - i);
+        expected(input.data() + i, n);
+        squelch(scaled.data() + i, n);
+    }
+    expected.update();
+    squelch.update();
+
+    EXPECT_EQ(squelch.idle_rate(), expected.idle_rate());
+}
+
+TEST_F(DataCarrierDetectTest, block_matches_sliding)
+{
+    // The demodulator's DCD: 271k samples/s, updated every 2168 samples.
+    constexpr size_t sample_rate = 271000;
+    constexpr size_t interval = 2168;
+
+    // Noise, RRC filtered 4-FSK as from opv-mod, noise, a shorter burst,
+    // noise.
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0, 0.02);
+    std::uniform_int_distribution<int> symbol(0, 3);
+    mobilinkd::FirInterpolator<double, 150, 10> rrc(mobilinkd::detail::Taps<double>::rrc_taps);
+    std::array<double, 10> baseband;
+    std::vector<float> input;
+    auto quiet = [&](size_t updates) {
+        for (size_t i = 0; i != updates * interval; ++i) input.push_back(noise(rng));
+    };
+    auto carrier = [&](size_t updates) {
+        for (size_t i = 0; i != updates * interval / 10; ++i)
+        {
+            rrc(symbol(rng) * 2 - 3, baseband.data());
+            for (auto b : baseband) input.push_back(b * 0.16 + noise(rng));
+        }
+    };
+    quiet(50);
+    carrier(100);
+    quiet(50);
+    carrier(40);
+    quiet(50);
+
+    auto sliding = mobilinkd::DataCarrierDetect<float, sample_rate, 500>(13500, 21500, 1.0, 4.0);
+    auto block = mobilinkd::BlockDataCarrierDetect<float, sample_rate, 500>(13500, 21500, 1.0, 4.0);
+    std::vector<bool> expected, actual;
+    for (size_t i = 0; i + interval <= input.size(); i += interval)
+    {
+        for (size_t j = 0; j != interval; ++j) sliding(input[i + j]);
+        block(input.data() + i, interval);
+        sliding.update();
+        block.update();
+        expected.push_back(sliding.dcd());
+        actual.push_back(block.dcd());
+    }
+
+    auto changes = [](const std::vector<bool>& dcd) {
+        std::vector<size_t> result;
+        for (size_t i = 1; i != dcd.size(); ++i)
+        {
+            if (dcd[i] != dcd[i - 1]) result.push_back(i);
+        }
+        return result;
+    };
+
+    // Two bursts, each detected and lost.  The level falls slowly through
+    // the lower threshold at the end of a burst, so the estimates, which
+    // differ a little, may cross it an update or two apart.
+    auto expected_changes = changes(expected);
+    auto actual_changes = changes(actual);
+    ASSERT_EQ(expected_changes.size(), 4u);
+    ASSERT_EQ(actual_changes.size(), expected_changes.size());
+    for (size_t i = 0; i != expected_changes.size(); ++i)
+    {
+        EXPECT_NEAR(double(actual_changes[i]), double(expected_changes[i]), 2.0) << "change " << i;
+    }
+}
@@ -0,0 +1,44 @@
+// Copyright 2026 Open Research Institute, Inc.
+
+#pragma once
+
+// Test helper: convolutionally encode data as the modulator does, as
+// soft decisions for the Viterbi and max-log-MAP decoders.
+
+#include "Convolution.h"
+#include "Numerology.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Rate 1/2 encode one bit per element, with 4 flush bits as in opv-mod,
+ * as +/-7 LLRs.
+ */
+template <size_t N>
+std::array<int8_t, (N + 4) * 2> encode_llr_bits(const std::array<uint8_t, N>& bits)
+{
+    std::array<int8_t, (N + 4) * 2> encoded;
+    size_t index = 0;
+    uint32_t memory = 0;
+    for (size_t i = 0; i != N + 4; ++i)
+    {
+        uint32_t x = i < N ? bits[i] & 1 : 0;
+        memory = mobilinkd::update_memory<4>(memory, x);
+        encoded[index++] = mobilinkd::convolve_bit(mobilinkd::ConvolutionPolyA, memory) * 14 - 7;
+        encoded[index++] = mobilinkd::convolve_bit(mobilinkd::ConvolutionPolyB, memory) * 14 - 7;
+    }
+    return encoded;
+}
+
+/**
+ * As encode_llr_bits(), for bytes packed MSB first.
+ */
+template <size_t N>
+std::array<int8_t, (N * 8 + 4) * 2> encode_llr(const std::array<uint8_t, N>& payload)
+{
+    std::array<uint8_t, N * 8> bits;
+    for (size_t i = 0; i != bits.size(); ++i) bits[i] = (payload[i / 8] >> (7 - i % 8)) & 1;
+    return encode_llr_bits(bits);
+}
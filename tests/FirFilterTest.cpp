@@ -0,0 +1,174 @@
+#include "FirFilter.h"
+#include "OPVDemodulator.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+uint32_t debug_sample_count = 0;
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class FirFilterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+
+  // void TearDown() override {}
+
+  static constexpr auto& taps = detail::Taps<float>::rrc_taps;
+  static constexpr size_t N = taps.size();
+
+  static std::vector<float> make_input(size_t count)
+  {
+      std::vector<float> input(count);
+      srand(23);
+      for (auto& x : input) x = (rand() % 2001 - 1000) / 1000.0;
+      return input;
+  }
+};
+
+TEST_F(FirFilterTest, matches_base_filter)
+{
+    BaseFirFilter<float, N> expected_filter(taps);
+    FirFilter<float, N> filter(taps);
+
+    for (auto x : make_input(1000))
+    {
+        EXPECT_NEAR(filter(x), expected_filter(x), 1e-5);
+    }
+}
+
+TEST_F(FirFilterTest, block_matches_sample)
+{
+    auto input = make_input(2000);
+
+    FirFilter<float, N> expected_filter(taps);
+    std::vector<float> expected;
+    for (auto x : input) expected.push_back(expected_filter(x));
+
+    // Uneven block sizes, including blocks longer than BLOCK_SIZE and an
+    // in-place block.
+    FirFilter<float, N> filter(taps);
+    std::vector<float> output = input;
+    const size_t sizes[] = {1, 7, 300, 64, 1000, 3};
+    size_t pos = 0;
+    for (size_t i = 0; pos != output.size(); ++i)
+    {
+        auto n = std::min(sizes[i % 6], output.size() - pos);
+        filter(output.data() + pos, output.data() + pos, n);
+        pos += n;
+    }
+
+    EXPECT_EQ(output, expected);
+
+    // And switching back to single samples keeps the history.
+    for (size_t i = 0; i != 10; ++i) EXPECT_EQ(filter(input[i]), expected_filter(input[i]));
+}
+
+TEST_F(FirFilterTest, fixed_point_matches_float)
+{
+    std::vector<int16_t> input;
+    for (auto x : make_input(2000)) input.push_back(x * 32767);
+
+    FirFilter<float, N> expected_filter(taps);
+    FixedPointFirFilter<N> filter(taps);
+    const float scale = 1.0 / (1 << filter.shift());
+    EXPECT_EQ(filter.shift(), 12);
+
+    // Each tap is rounded by at most half of 2^-shift.
+    const float max_error = N * 32768 * scale / 2;
+
+    std::vector<int32_t> output;
+    for (auto x : input)
+    {
+        output.push_back(filter(x));
+        EXPECT_NEAR(output.back() * scale, expected_filter(x), max_error);
+    }
+
+    // The block filter gives exactly the same outputs.
+    FixedPointFirFilter<N> block_filter(taps);
+    std::vector<int32_t> block_output(input.size());
+    block_filter(input.data(), block_output.data(), 7);
+    block_filter(input.data() + 7, block_output.data() + 7, input.size() - 7);
+    EXPECT_EQ(block_output, output);
+}
+
+TEST_F(FirFilterTest, benchmark)
+{
+    auto input = make_input(100000);
+    std::vector<float> output(input.size());
+
+    BaseFirFilter<float, N> base_filter(taps);
+    FirFilter<float, N> filter(taps);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i != input.size(); ++i) output[i] = base_filter(input[i]);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i != input.size(); ++i) output[i] = filter(input[i]);
+    auto t2 = std::chrono::high_resolution_clock::now();
+    filter(input.data(), output.data(), input.size());
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Per sample: BaseFirFilter " << (t1 - start).count() / input.size()
+        << "ns, FirFilter " << (t2 - t1).count() / input.size()
+        << "ns, FirFilter block " << (t3 - t2).count() / input.size() << "ns" << std::endl;
+}
+
+TEST_F(FirFilterTest, interpolator_matches_zero_stuffed)
+{
+    // 4-level symbols interpolated by 10, as in opv-mod.
+    std::array<double, 150> interpolation_taps;
+    srand(29);
+    for (auto& h : interpolation_taps) h = (rand() % 2001 - 1000) / 1000.0;
+
+    BaseFirFilter<double, 150> expected_filter(interpolation_taps);
+    FirInterpolator<double, 150, 10> interpolator(interpolation_taps);
+
+    std::array<double, 10> output;
+    for (size_t i = 0; i != 500; ++i)
+    {
+        double symbol = (rand() % 4) * 2 - 3;
+        interpolator(symbol, output.data());
+        for (size_t p = 0; p != 10; ++p)
+        {
+            EXPECT_EQ(output[p], expected_filter(p == 0 ? symbol : 0.0));
+        }
+    }
+}
+
+TEST_F(FirFilterTest, fixed_point_interpolator)
+{
+    // Small enough taps that the output fits in int16 at full scale.
+    std::array<double, 150> interpolation_taps;
+    srand(31);
+    for (auto& h : interpolation_taps) h = (rand() % 2001 - 1000) / 10000.0;
+
+    for (double scale : {7168.0, -7168.0})
+    {
+        FirInterpolator<double, 150, 10> expected_interpolator(interpolation_taps);
+        FixedPointInterpolator<150, 10> interpolator(interpolation_taps, scale);
+
+        std::array<double, 10> expected;
+        std::array<int16_t, 10> output;
+        for (size_t i = 0; i != 1000; ++i)
+        {
+            int8_t symbol = i < 500 ? (rand() % 4) * 2 - 3 : rand() % 7 - 3;
+            expected_interpolator(symbol, expected.data());
+            interpolator(symbol, output.data());
+            for (size_t p = 0; p != 10; ++p)
+            {
+                EXPECT_NEAR(output[p], int16_t(expected[p] * scale), 1);
+            }
+        }
+    }
+}
@@ -3,6 +3,9 @@
 #include <gtest/gtest.h>
 
 #include <cstdint>
+#include <random>
+
+uint32_t debug_sample_count = 0;
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -52,3 +55,17 @@ TEST_F(FrameHeaderTest, decode_callsign_2)
     EXPECT_EQ(callsign[6], 0);
 }
 
+
+TEST_F(FrameHeaderTest, random_soft_bits_fail)
+{
+    // Noise instead of a header must not decode to a callsign and flags.
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> soft(-127, 127);
+    for (size_t trial = 0; trial != 100; ++trial)
+    {
+        mobilinkd::OPVFrameHeader fheader;
+        mobilinkd::OPVFrameHeader::encoded_fheader_t encoded;
+        for (auto& s : encoded) s = soft(rng);
+        EXPECT_EQ(fheader.update_frame_header(encoded), mobilinkd::OPVFrameHeader::HeaderResult::FAIL);
+    }
+}
@@ -2,7 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <cstdlib>
 #include <bitset>
 
 int main(int argc, char **argv) {
@@ -115,7 +118,7 @@ TEST_F(Golay24Test, decode_map)
 #if 0
     size_t c = 0;
     for (auto x : mobilinkd::Golay24::LUT) {
-        std::cout << std::hex << std::setfill('0') << std::setw(8) << x.a << ":" << std::setw(4) << x.b;
+        std::cout << std::hex << std::setfill('0') << std::setw(6) << x;
         if (c++ == 7) {
             c = 0;
             std::cout << std::endl;
@@ -149,4 +152,184 @@ TEST_F(Golay24Test, interop)
         EXPECT_TRUE(mobilinkd::Golay24::decode(encoded[i], decoded));
         EXPECT_EQ(decoded >> 12, expected[i]);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(Golay24Test, lut)
+{
+    // Every syndrome maps back to an error pattern of at most 3 bits.
+    for (uint32_t s = 0; s != mobilinkd::Golay24::LUT_SIZE; ++s)
+    {
+        auto v = mobilinkd::Golay24::LUT[s];
+        EXPECT_LE(std::popcount(v), 3);
+        EXPECT_EQ(mobilinkd::Golay24::syndrome(v), s << 12);
+    }
+}
+
+TEST_F(Golay24Test, decode_all_correctable)
+{
+    uint16_t data = 0xA5C;
+    auto encoded = mobilinkd::Golay24::encode24(data);
+
+    // All error patterns of up to 3 bits over the 24-bit codeword.
+    for (uint32_t i = 0; i != 24; ++i)
+    {
+        for (uint32_t j = i; j != 24; ++j)
+        {
+            for (uint32_t k = j; k != 24; ++k)
+            {
+                uint32_t corruption = (1U << i) | (1U << j) | (1U << k);
+                uint32_t decoded = 0;
+                bool ok = mobilinkd::Golay24::decode(encoded ^ corruption, decoded);
+                if (!(corruption & 1))
+                {
+                    EXPECT_TRUE(ok) << std::hex << corruption;
+                    EXPECT_EQ(decoded, encoded) << std::hex << corruption;
+                }
+                else
+                {
+                    // A parity bit error is accepted only with the other
+                    // errors in bits 23..13, and is not corrected.
+                    EXPECT_EQ(ok, (corruption & 0x1FFEU) == 0) << std::hex << corruption;
+                    if (ok)
+                    {
+                        EXPECT_EQ(decoded, encoded ^ 1) << std::hex << corruption;
+                    }
+                }
+            }
+        }
+    }
+
+    // A bit above the codeword is rejected.
+    uint32_t decoded = 0;
+    EXPECT_FALSE(mobilinkd::Golay24::decode(encoded | (1U << 24), decoded));
+}
+
+TEST_F(Golay24Test, decode_n)
+{
+    std::array<uint32_t, 8> encoded, decoded;
+    for (size_t i = 0; i != encoded.size(); ++i)
+    {
+        encoded[i] = mobilinkd::Golay24::encode24(0x111 * i) ^ (1U << (i * 3));
+    }
+    encoded[5] = 0xD7880FU ^ 0x011110;  // uncorrectable, as in decode_corrupted_4
+
+    auto failed = mobilinkd::Golay24::decode_n(encoded, decoded);
+    EXPECT_EQ(failed, 1U << 5);
+    for (size_t i = 0; i != encoded.size(); ++i)
+    {
+        if (i != 5)
+        {
+            EXPECT_EQ(decoded[i] >> 12, 0x111 * i);
+        }
+    }
+}
+
+namespace {
+
+std::array<int8_t, 24> to_soft(uint32_t codeword, int8_t level)
+{
+    std::array<int8_t, 24> soft;
+    for (size_t i = 0; i != 24; ++i)
+    {
+        soft[i] = ((codeword >> (23 - i)) & 1) ? level : -level;
+    }
+    return soft;
+}
+
+} // namespace
+
+TEST_F(Golay24Test, decode_soft_clean)
+{
+    auto encoded = mobilinkd::Golay24::encode24(0xD78);
+    auto soft = to_soft(encoded, 100);
+
+    uint32_t decoded = 0;
+    int32_t confidence = 0;
+    EXPECT_TRUE(mobilinkd::Golay24::decode_soft(soft.data(), decoded, confidence));
+    EXPECT_EQ(decoded, encoded);
+    EXPECT_EQ(confidence, 2400);
+}
+
+TEST_F(Golay24Test, decode_soft_weak_errors)
+{
+    auto encoded = mobilinkd::Golay24::encode24(0xD78);
+    auto soft = to_soft(encoded, 100);
+
+    // Four weak errors are beyond the hard decoder.
+    for (size_t i : {2, 7, 13, 20}) soft[i] = soft[i] > 0 ? -10 : 10;
+    uint32_t hard = 0;
+    for (size_t i = 0; i != 24; ++i) hard |= uint32_t(soft[i] > 0) << (23 - i);
+    uint32_t decoded = 0;
+    EXPECT_FALSE(mobilinkd::Golay24::decode(hard, decoded) && (decoded >> 12) == 0xD78);
+
+    int32_t confidence = 0;
+    EXPECT_TRUE(mobilinkd::Golay24::decode_soft(soft.data(), decoded, confidence));
+    EXPECT_EQ(decoded, encoded);
+    EXPECT_EQ(confidence, 2000 - 4 * 10);
+}
+
+TEST_F(Golay24Test, decode_soft_not_worse_than_hard)
+{
+    srand(71);
+    size_t hard_ok = 0, soft_ok = 0;
+    for (size_t trial = 0; trial != 2000; ++trial)
+    {
+        uint16_t data = rand() & 0xFFF;
+        auto soft = to_soft(mobilinkd::Golay24::encode24(data), 20);
+        for (auto& s : soft) s += rand() % 61 - 30;
+
+        uint32_t hard = 0;
+        for (size_t i = 0; i != 24; ++i) hard |= uint32_t(soft[i] > 0) << (23 - i);
+
+        uint32_t decoded = 0;
+        int32_t confidence = 0;
+        hard_ok += mobilinkd::Golay24::decode(hard, decoded) && (decoded >> 12) == data;
+        soft_ok += mobilinkd::Golay24::decode_soft(soft.data(), decoded, confidence) && (decoded >> 12) == data;
+    }
+    std::cout << "Hard: " << hard_ok << ", soft: " << soft_ok << " of 2000" << std::endl;
+    EXPECT_GT(soft_ok, hard_ok);
+}
+
+TEST_F(Golay24Test, decode_soft_rejects_random)
+{
+    // Random words fail soft decoding about as often as hard decoding.
+    srand(73);
+    size_t hard_failed = 0, soft_failed = 0;
+    for (size_t trial = 0; trial != 2000; ++trial)
+    {
+        std::array<int8_t, 24> soft;
+        uint32_t hard = 0;
+        for (size_t i = 0; i != 24; ++i)
+        {
+            soft[i] = rand() % 255 - 127;
+            hard |= uint32_t(soft[i] > 0) << (23 - i);
+        }
+
+        uint32_t decoded = 0;
+        int32_t confidence = 0;
+        hard_failed += !mobilinkd::Golay24::decode(hard, decoded);
+        soft_failed += !mobilinkd::Golay24::decode_soft(soft.data(), decoded, confidence);
+    }
+    std::cout << "Random words failed: hard " << hard_failed << ", soft " << soft_failed << " of 2000" << std::endl;
+    EXPECT_GT(soft_failed, hard_failed * 9 / 10);
+}
+
+TEST_F(Golay24Test, decode_soft_n)
+{
+    std::array<int8_t, 24 * 8> soft;
+    for (size_t i = 0; i != 8; ++i)
+    {
+        auto s = to_soft(mobilinkd::Golay24::encode24(0x111 * i), 50);
+        std::copy(s.begin(), s.end(), soft.begin() + 24 * i);
+    }
+    soft[24 * 3 + 5] = -soft[24 * 3 + 5];
+
+    std::array<uint32_t, 8> decoded;
+    std::array<int32_t, 8> confidence;
+    EXPECT_EQ(mobilinkd::Golay24::decode_soft_n(soft.data(), decoded, confidence), 0);
+    for (size_t i = 0; i != 8; ++i)
+    {
+        EXPECT_EQ(decoded[i] >> 12, 0x111 * i);
+        EXPECT_EQ(confidence[i], i == 3 ? 1100 : 1200);
+    }
+}
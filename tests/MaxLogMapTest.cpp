@@ -0,0 +1,126 @@
+#include "MaxLogMap.h"
+#include "Viterbi.h"
+#include "Trellis.h"
+#include "Numerology.h"
+#include "EncodeLlr.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class MaxLogMapTest : public ::testing::Test {
+ protected:
+  using input_t = std::array<int8_t, stream_type3_payload_size>;
+  using output_t = std::array<uint8_t, stream_frame_payload_size>;
+  using llr_t = std::array<int16_t, stream_frame_payload_size>;
+
+  Trellis<4,2> trellis{makeTrellis<4, 2>({ConvolutionPolyA,ConvolutionPolyB})};
+
+  void SetUp() override {}
+
+  // Encode random bits.
+  static input_t encode(output_t& bits)
+  {
+      for (auto& bit : bits) bit = rand() & 1;
+      return encode_llr_bits(bits);
+  }
+};
+
+TEST_F(MaxLogMapTest, matches_viterbi)
+{
+    Viterbi<decltype(trellis), 4> viterbi(trellis);
+    MaxLogMap<decltype(trellis), 4> decoder(trellis);
+
+    input_t encoded;
+    output_t expected;
+    llr_t llr;
+
+    srand(59);
+    for (size_t frame = 0; frame != 10; ++frame)
+    {
+        for (auto& e : encoded) e = rand() % 15 - 7;
+
+        auto expected_cost = viterbi.decode(encoded, expected);
+        auto cost = decoder.decode(encoded, llr);
+        EXPECT_EQ(cost, expected_cost);
+
+        for (size_t i = 0; i != llr.size(); ++i)
+        {
+            if (llr[i] == 0) continue;  // tie between two best paths
+            EXPECT_EQ(llr[i] > 0, expected[i] == 1) << "frame " << frame << " bit " << i;
+        }
+    }
+}
+
+TEST_F(MaxLogMapTest, reliability)
+{
+    MaxLogMap<decltype(trellis), 4> decoder(trellis);
+
+    output_t bits;
+    llr_t llr;
+    srand(61);
+    auto encoded = encode(bits);
+
+    // Weaken a burst in the middle of the frame, with two errors.
+    for (size_t i = 1000; i != 1040; ++i) encoded[i] /= 7;
+    encoded[1005] = -encoded[1005];
+    encoded[1023] = -encoded[1023];
+
+    decoder.decode(encoded, llr);
+
+    int32_t clean = std::numeric_limits<int32_t>::max();
+    int32_t noisy = std::numeric_limits<int32_t>::max();
+    for (size_t i = 0; i != llr.size(); ++i)
+    {
+        EXPECT_EQ(llr[i] > 0, bits[i] == 1) << "bit " << i;
+        if (i >= 500 && i < 520) noisy = std::min<int32_t>(noisy, std::abs(llr[i]));
+        if (i < 400) clean = std::min<int32_t>(clean, std::abs(llr[i]));
+    }
+    EXPECT_LT(noisy, clean);
+
+    auto confidence = byte_confidence(llr);
+    EXPECT_LT(confidence[63], confidence[10]);
+}
+
+TEST_F(MaxLogMapTest, benchmark)
+{
+    Viterbi<decltype(trellis), 4> viterbi(trellis);
+    MaxLogMap<decltype(trellis), 4> decoder(trellis);
+
+    input_t encoded;
+    output_t output;
+    llr_t llr;
+    srand(67);
+    for (auto& e : encoded) e = rand() % 15 - 7;
+
+    constexpr size_t FRAMES = 20;
+    viterbi.decode(encoded, output);
+    decoder.decode(encoded, llr);
+
+    size_t expected_cost = 0;
+    size_t cost = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i != FRAMES; ++i) expected_cost = viterbi.decode(encoded, output);
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i != FRAMES; ++i) cost = decoder.decode(encoded, llr);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Per frame: Viterbi " << (mid - start).count() / FRAMES
+        << "ns, max-log-MAP " << (end - mid).count() / FRAMES << "ns" << std::endl;
+
+    EXPECT_EQ(cost, expected_cost);
+    for (size_t i = 0; i != llr.size(); ++i)
+    {
+        if (llr[i] == 0) continue;  // tie between two best paths
+        EXPECT_EQ(llr[i] > 0, output[i] == 1) << "bit " << i;
+    }
+}
@@ -0,0 +1,324 @@
+#include "EncodeLlr.h"
+#include "OPVDemodulator.h"
+#include "OPVRandomizer.h"
+#include "Numerology.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <tuple>
+#include <vector>
+
+uint32_t debug_sample_count = 0;
+OPVCobsDecoder cobs_decoder;
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OPVDemodulatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+
+  // void TearDown() override {}
+
+  using demod_t = OPVDemodulator<float>;
+  using diagnostic_t = std::tuple<bool, float, float, float, bool, float, int, int, int, int>;
+
+  static constexpr float scale = -1.0 / 44000.0;
+
+  // A quiet start, a preamble (alternating +3/-3 symbols) and then random
+  // symbols, as rectangular pulses of 10 samples.
+  static std::vector<int16_t> make_baseband()
+  {
+      std::vector<int16_t> samples;
+      srand(17);
+      for (size_t i = 0; i != samples_per_frame * 2; ++i) samples.push_back(rand() % 201 - 100);
+      for (size_t i = 0; i != baseband_frame_symbols * 3; ++i) samples.insert(samples.end(), 10, i & 1 ? -9000 : 9000);
+      const int16_t symbols[] = {-9000, -3000, 3000, 9000};
+      for (size_t i = 0; i != baseband_frame_symbols * 3; ++i) samples.insert(samples.end(), 10, symbols[rand() % 4]);
+      for (size_t i = 0; i != samples_per_frame * 2; ++i) samples.push_back(rand() % 201 - 100);
+      return samples;
+  }
+
+  // A one frame preamble, as opv-mod sends, and then frames of all zero
+  // data, which are sent as just the randomizer's bits.
+  static std::vector<int16_t> make_frames(size_t frames, double noise, double ppm = 0)
+  {
+      std::vector<int8_t> symbols;
+      for (size_t f = 0; f != frames; ++f)
+      {
+          symbols.insert(symbols.end(), std::begin(sync_word), std::end(sync_word));
+          for (size_t i = 0; i != stream_type4_size; i += 2)
+          {
+              auto dibit = (get_bit_index(detail::DC, i) << 1) | get_bit_index(detail::DC, i + 1);
+              symbols.push_back(dibit_symbols[dibit]);
+          }
+      }
+      return modulate(symbols, noise, ppm);
+  }
+
+  // A one frame preamble and then stream frames built as opv-mod builds
+  // them: a Golay encoded frame header and a convolutionally encoded
+  // random @p payloads, interleaved and randomized.
+  static std::vector<int16_t> make_stream(const std::vector<OPVFrameDecoder::stream_type1_bytes_t>& payloads, double noise)
+  {
+      OPVFrameHeader::call_t callsign = {'W', '1', 'A', 'W'};
+      std::array<uint8_t, fheader_size_bytes> fheader = {};
+      auto encoded_callsign = OPVFrameHeader::encode_callsign(callsign);
+      std::copy(encoded_callsign.begin(), encoded_callsign.end(), fheader.begin());
+
+      std::array<int8_t, stream_type4_size> frame;
+      size_t index = 0;
+      for (size_t i = 0; i != fheader_size_bytes; i += 3)
+      {
+          for (auto data : {fheader[i] << 4 | fheader[i + 1] >> 4, (fheader[i + 1] & 0x0F) << 8 | fheader[i + 2]})
+          {
+              auto codeword = Golay24::encode24(data);
+              for (size_t j = 0; j != 24; ++j) frame[index++] = (codeword >> (23 - j)) & 1;
+          }
+      }
+      const size_t payload_offset = index;
+
+      PolynomialInterleaver<PolynomialInterleaverX, PolynomialInterleaverX2, stream_type4_size> interleaver;
+      OPVRandomizer<stream_type4_size> randomizer;
+
+      std::vector<int8_t> symbols;
+      for (auto& payload : payloads)
+      {
+          index = payload_offset;
+          for (auto llr : encode_llr(payload)) frame[index++] = llr > 0;
+          auto bits = frame;
+          interleaver.interleave(bits);
+          randomizer.randomize(bits);
+
+          symbols.insert(symbols.end(), std::begin(sync_word), std::end(sync_word));
+          for (size_t i = 0; i != stream_type4_size; i += 2)
+          {
+              symbols.push_back(dibit_symbols[bits[i] << 1 | bits[i + 1]]);
+          }
+      }
+      return modulate(symbols, noise, 0);
+  }
+
+  static constexpr int8_t sync_word[] = {-3, -3, -3, -3, 3, 3, -3, 3};
+  static constexpr int8_t dibit_symbols[] = {1, 3, -1, -3};
+
+  // Two frames of noise, a one frame preamble, @p symbols and a frame of
+  // silence, RRC filtered as by opv-mod, with Gaussian noise.  The signal
+  // is resampled to a transmitter clock @p ppm slower than the receiver's.
+  static std::vector<int16_t> modulate(std::vector<int8_t> symbols, double noise, double ppm)
+  {
+      std::vector<int8_t> preamble;
+      for (size_t i = 0; i != baseband_frame_symbols; ++i) preamble.push_back(i & 1 ? -3 : 3);
+      symbols.insert(symbols.begin(), preamble.begin(), preamble.end());
+      symbols.insert(symbols.end(), baseband_frame_symbols, 0);
+
+      std::mt19937 rng(11);
+      std::normal_distribution<double> gaussian(0, noise);
+      std::vector<int16_t> samples;
+      for (size_t i = 0; i != samples_per_frame * 2; ++i) samples.push_back(gaussian(rng));
+
+      FirInterpolator<double, 150, 10> rrc(detail::Taps<double>::rrc_taps);
+      std::array<double, 10> phases;
+      std::vector<double> baseband;
+      for (auto symbol : symbols)
+      {
+          rrc(symbol, phases.data());
+          for (auto b : phases) baseband.push_back(b * 7168.0);
+      }
+
+      const double step = 1.0 + ppm * 1e-6;
+      for (double t = 0; t < baseband.size() - 1; t += step)
+      {
+          size_t k = t;
+          double b = baseband[k] + (baseband[k + 1] - baseband[k]) * (t - k);
+          samples.push_back(std::clamp(b + gaussian(rng), -32767.0, 32767.0));
+      }
+      return samples;
+  }
+
+  static std::vector<diagnostic_t> run(demod_t& demod, std::function<void(demod_t&)> feed)
+  {
+      std::vector<diagnostic_t> result;
+      demod.diagnostics([&result](bool dcd, float error, float deviation, float offset, bool locked,
+          float clock, int sample_index, int sync_index, int clock_index, int viterbi_cost) {
+          result.emplace_back(dcd, error, deviation, offset, locked, clock, sample_index, sync_index, clock_index, viterbi_cost);
+      });
+      debug_sample_count = 0;
+      feed(demod);
+      return result;
+  }
+};
+
+TEST_F(OPVDemodulatorTest, process_matches_per_sample)
+{
+    auto samples = make_baseband();
+    auto callback = [](const OPVFrameDecoder::output_buffer_t&, int) { return true; };
+
+    demod_t expected_demod(callback);
+    auto expected = run(expected_demod, [&samples](demod_t& demod) {
+        for (auto s : samples)
+        {
+            demod(s * scale);
+            debug_sample_count++;
+        }
+    });
+
+    // Uneven block sizes, so that blocks split DCD intervals.
+    demod_t actual_demod(callback);
+    auto actual = run(actual_demod, [&samples](demod_t& demod) {
+        std::span<const int16_t> input(samples);
+        size_t size = 1;
+        while (!input.empty())
+        {
+            auto n = std::min(input.size(), size);
+            demod.process(input.first(n), scale);
+            input = input.subspan(n);
+            size = size * 3 + 1;
+            if (size > 5000) size = 7;
+        }
+    });
+
+    ASSERT_FALSE(expected.empty());
+    EXPECT_TRUE(std::any_of(expected.begin(), expected.end(), [](auto& d) { return std::get<0>(d); }));
+    EXPECT_EQ(actual, expected);
+    EXPECT_EQ(debug_sample_count, samples.size());
+}
+
+TEST_F(OPVDemodulatorTest, fixed_point_ber)
+{
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<OPVFrameDecoder::stream_type1_bytes_t> payloads(20);
+    for (auto& payload : payloads)
+    {
+        for (auto& b : payload) b = byte(rng);
+    }
+
+    // Noisy enough to have some bit errors.
+    auto samples = make_stream(payloads, 20000);
+
+    auto ber = [&](bool fixed_point) {
+        size_t frames = 0;
+        size_t errors = 0;
+        demod_t demod([&](const OPVFrameDecoder::output_buffer_t& frame, int) {
+            if (frames < payloads.size())
+            {
+                for (size_t i = 0; i != frame.data.size(); ++i)
+                {
+                    errors += std::popcount(uint8_t(frame.data[i] ^ payloads[frames][i]));
+                }
+            }
+            frames += 1;
+            return true;
+        });
+        demod.fixed_point(fixed_point);
+        debug_sample_count = 0;
+        demod.process(samples, -scale);
+        return std::make_tuple(frames, errors);
+    };
+
+    auto [expected_frames, expected_errors] = ber(false);
+    auto [frames, errors] = ber(true);
+
+    std::cout << "Float: " << expected_frames << " frames, " << expected_errors << " bit errors. "
+        << "Fixed point: " << frames << " frames, " << errors << " bit errors." << std::endl;
+
+    EXPECT_EQ(expected_frames, payloads.size());
+    EXPECT_GT(expected_errors, 0u);
+    EXPECT_EQ(frames, expected_frames);
+    EXPECT_LE(errors, expected_errors + expected_errors / 10 + 10);
+}
+
+TEST_F(OPVDemodulatorTest, sync_before_frames)
+{
+    auto samples = make_frames(5, 1000);
+
+    std::vector<char> events;
+    demod_t demod([&events](const OPVFrameDecoder::output_buffer_t&, int) {
+        events.push_back('F');
+        return true;
+    });
+    demod.on_sync([&events]() { events.push_back('S'); });
+    debug_sample_count = 0;
+    demod.process(samples, -scale);
+
+    ASSERT_GE(events.size(), 5u);
+    EXPECT_EQ(events.front(), 'S');
+    EXPECT_GE(std::count(events.begin(), events.end(), 'F'), 5);
+}
+
+TEST_F(OPVDemodulatorTest, squelch_decodes_same_frames)
+{
+    using frame_t = std::tuple<OPVFrameDecoder::stream_type1_bytes_t, int>;
+
+    auto decode = [](const std::vector<int16_t>& samples, bool squelch) {
+        std::vector<frame_t> frames;
+        demod_t demod([&frames](const OPVFrameDecoder::output_buffer_t& frame, int cost) {
+            frames.emplace_back(frame.data, cost);
+            return true;
+        });
+        demod.squelch_enabled(squelch);
+        debug_sample_count = 0;
+        demod.process(samples, -scale);
+        return frames;
+    };
+
+    // From a clean signal to one with many bit errors, after an idle
+    // channel long enough for the squelch to close and adapt.
+    std::mt19937 rng(13);
+    for (double noise : {1000.0, 10000.0, 20000.0, 24000.0})
+    {
+        std::normal_distribution<double> gaussian(0, noise);
+        std::vector<int16_t> samples(samples_per_frame * 20);
+        for (auto& s : samples) s = std::clamp(gaussian(rng), -32767.0, 32767.0);
+
+        demod_t idle([](const OPVFrameDecoder::output_buffer_t&, int) { return true; });
+        idle.squelch_enabled(true);
+        idle.process(samples, -scale);
+        EXPECT_FALSE(idle.squelch_open_) << "noise " << noise;
+
+        auto frames = make_frames(20, noise);
+        samples.insert(samples.end(), frames.begin(), frames.end());
+        auto expected = decode(samples, false);
+        auto actual = decode(samples, true);
+        EXPECT_GE(expected.size(), 19u) << "noise " << noise;
+        EXPECT_EQ(actual.size(), expected.size()) << "noise " << noise;
+        EXPECT_TRUE(actual == expected) << "noise " << noise;
+    }
+}
+
+TEST_F(OPVDemodulatorTest, clock_offset)
+{
+    // Count the frames that decode to the all zero data that was sent.
+    auto decode = [](const std::vector<int16_t>& samples) {
+        size_t frames = 0;
+        demod_t demod([&frames](const OPVFrameDecoder::output_buffer_t& frame, int) {
+            frames += std::all_of(frame.data.begin(), frame.data.end(), [](auto b) { return b == 0; });
+            return true;
+        });
+        debug_sample_count = 0;
+        demod.process(samples, -scale);
+        return frames;
+    };
+
+    // Transmitter clocks within +/-90 ppm of the receiver's, about one
+    // sample of drift per frame. At the extremes the timing error raises
+    // the Viterbi cost, so that much noisier signals eventually drop lock.
+    for (double ppm : {-90.0, -45.0, 0.0, 45.0, 90.0})
+    {
+        for (double noise : {1000.0, 2000.0})
+        {
+            EXPECT_EQ(decode(make_frames(40, noise, ppm)), 40u) << ppm << " ppm, noise " << noise;
+        }
+    }
+}
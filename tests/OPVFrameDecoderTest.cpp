@@ -0,0 +1,102 @@
+#include "OPVFrameDecoder.h"
+#include "Numerology.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+uint32_t debug_sample_count = 0;
+
+using namespace mobilinkd;
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OPVFrameDecoderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+
+  // void TearDown() override {}
+
+  OPVFrameDecoder decoder{[](const OPVFrameDecoder::output_buffer_t&, int) { return true; }};
+
+  OPVFrameDecoder::encoded_fheader_t fheader;
+  OPVFrameDecoder::stream_type3_buffer_t payload;
+
+  // The multi-pass path: copy out of the framer, derandomize, deinterleave
+  // in place, then split the frame into header and payload.
+  void unpack_reference(const int8_t* frame)
+  {
+      OPVFrameDecoder::frame_type4_buffer_t buffer;
+      std::copy(frame, frame + stream_type4_size, buffer.begin());
+      decoder.derandomize_(buffer);
+      decoder.interleaver_.deinterleave(buffer);
+      std::copy(buffer.begin(), buffer.begin() + encoded_fheader_size, fheader.begin());
+      std::copy(buffer.begin() + encoded_fheader_size, buffer.end(), payload.begin());
+  }
+};
+
+TEST_F(OPVFrameDecoderTest, unpack)
+{
+    OPVFrameDecoder::frame_type4_buffer_t frame;
+    srand(11);
+    for (auto& f : frame) f = rand() % 15 - 7;
+    auto original = frame;
+
+    unpack_reference(frame.data());
+    auto expected_fheader = fheader;
+    auto expected_payload = payload;
+
+    fheader.fill(0);
+    payload.fill(0);
+    decoder.unpack(frame.data(), fheader, payload);
+
+    EXPECT_EQ(fheader, expected_fheader);
+    EXPECT_EQ(payload, expected_payload);
+    EXPECT_EQ(frame, original);
+}
+
+TEST_F(OPVFrameDecoderTest, benchmark)
+{
+    OPVFrameDecoder::frame_type4_buffer_t frame;
+    srand(13);
+    for (auto& f : frame) f = rand() % 15 - 7;
+
+    constexpr size_t FRAMES = 1000;
+    constexpr size_t N = stream_type4_size;
+
+    // Bytes read and written per frame.  The reference path copies the
+    // frame (2N), derandomizes it (3N), gathers it through the 16-bit
+    // permutation (4N) and copies it back (2N), then splits it (2N).  The
+    // fused path reads the frame, the permutation and the signs and writes
+    // the output once.
+    constexpr size_t reference_bytes = 2 * N + 3 * N + 4 * N + 2 * N + 2 * N;
+    constexpr size_t fused_bytes = N + 2 * N + N + N;
+
+    // Best of several rounds, to keep scheduling noise out of the result.
+    using clock = std::chrono::high_resolution_clock;
+    clock::duration reference_time = clock::duration::max();
+    clock::duration fused_time = clock::duration::max();
+    for (size_t round = 0; round != 5; ++round)
+    {
+        auto start = clock::now();
+        for (size_t i = 0; i != FRAMES; ++i) unpack_reference(frame.data());
+        auto mid = clock::now();
+        for (size_t i = 0; i != FRAMES; ++i) decoder.unpack(frame.data(), fheader, payload);
+        auto end = clock::now();
+        reference_time = std::min(reference_time, mid - start);
+        fused_time = std::min(fused_time, end - mid);
+    }
+
+    std::cout << "Per frame: multi-pass " << reference_time.count() / FRAMES << "ns, "
+        << reference_bytes << " bytes; fused " << fused_time.count() / FRAMES << "ns, "
+        << fused_bytes << " bytes" << std::endl;
+
+    EXPECT_LT(fused_bytes, reference_bytes);
+}
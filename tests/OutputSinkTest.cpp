@@ -0,0 +1,85 @@
+#include "OutputSink.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class OutputSinkTest : public ::testing::Test {
+ protected:
+  std::string path;
+
+  void SetUp() override
+  {
+      // ctest runs each test as its own process, possibly in parallel.
+      auto name = ::testing::UnitTest::GetInstance()->current_test_info()->name();
+      path = testing::TempDir() + "OutputSinkTest." + name + ".bin";
+  }
+
+  void TearDown() override
+  {
+      std::remove(path.c_str());
+  }
+
+  std::vector<uint8_t> contents() const
+  {
+      std::ifstream file(path, std::ios::binary);
+      return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+};
+
+TEST_F(OutputSinkTest, buffered)
+{
+    mobilinkd::OutputSink sink(path, 16);
+    sink.put(1);
+    sink.write("\x02\x03", 2);
+    EXPECT_TRUE(contents().empty());
+
+    sink.flush();
+    EXPECT_EQ(contents(), (std::vector<uint8_t>{1, 2, 3}));
+    EXPECT_FALSE(sink.failed());
+}
+
+TEST_F(OutputSinkTest, large_write)
+{
+    // Bigger than the buffer: it goes out with what is buffered.
+    std::vector<uint8_t> expected = {0xAA};
+    for (size_t i = 0; i != 100; ++i) expected.push_back(i);
+
+    {
+        mobilinkd::OutputSink sink(path, 16);
+        sink.put(0xAA);
+        sink.write(expected.data() + 1, 100);
+        EXPECT_EQ(contents(), expected);
+        for (size_t i = 0; i != 40; ++i) sink.put(i);     // fills and flushes
+        for (size_t i = 0; i != 40; ++i) expected.push_back(i);
+    }
+    EXPECT_EQ(contents(), expected);    // the destructor flushes
+}
+
+TEST_F(OutputSinkTest, write_le)
+{
+    const int16_t samples[] = {0x0102, -2};
+    {
+        mobilinkd::OutputSink sink(path);
+        sink.write_le(samples, 2);
+    }
+    EXPECT_EQ(contents(), (std::vector<uint8_t>{0x02, 0x01, 0xFE, 0xFF}));
+}
+
+TEST_F(OutputSinkTest, open_failed)
+{
+    mobilinkd::OutputSink sink(testing::TempDir() + "no/such/directory/file");
+    EXPECT_TRUE(sink.failed());
+    sink.write("abc", 3);
+    sink.flush();
+}
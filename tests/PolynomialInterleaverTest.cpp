@@ -65,4 +65,45 @@ TEST_F(PolynomialInterleaverTest, deinterleave)
     {
         EXPECT_EQ(dc[i], mobilinkd::detail::DC[i]);
     }
-}
\ No newline at end of file
+}
+
+TEST_F(PolynomialInterleaverTest, permutation_table)
+{
+    using interleaver_t = PolynomialInterleaver<>;
+    for (size_t i = 0; i != stream_type4_size; ++i)
+    {
+        uint64_t expected = ((PolynomialInterleaverX * i) + ((uint64_t)PolynomialInterleaverX2 * i * i)) % stream_type4_size;
+        EXPECT_EQ(interleaver_t::permutation[i], expected);
+        EXPECT_EQ(interleaver_t::inverse[interleaver_t::permutation[i]], i);
+    }
+}
+
+TEST_F(PolynomialInterleaverTest, derandomize_deinterleave)
+{
+    using buffer_t = PolynomialInterleaver<>::buffer_t;
+
+    buffer_t frame;
+    for (size_t i = 0; i != stream_type4_size; ++i)
+    {
+        frame[i] = int8_t((i * 37) % 255) - 127;
+    }
+
+    // Two passes, as the decoder used to do it.
+    buffer_t expected = frame;
+    OPVRandomizer<stream_type4_size> derandomize;
+    PolynomialInterleaver interleaver;
+    derandomize(expected);
+    interleaver.deinterleave(expected);
+
+    buffer_t signs;
+    for (size_t i = 0; i != stream_type4_size; ++i)
+    {
+        signs[i] = derandomize.dc_[interleaver.index(i)];
+    }
+
+    // In two pieces, as the decoder unpacks the header and the payload.
+    buffer_t actual;
+    interleaver.deinterleave(frame.data(), signs.data(), 0, 192, actual.data());
+    interleaver.deinterleave(frame.data(), signs.data(), 192, stream_type4_size - 192, actual.data() + 192);
+    EXPECT_EQ(actual, expected);
+}
@@ -0,0 +1,142 @@
+#include "queue.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+class QueueTest : public ::testing::Test {
+ protected:
+  void SetUp() override {}
+
+  // void TearDown() override {}
+};
+
+using spsc_t = mobilinkd::spsc_queue<int, 8>;
+
+TEST_F(QueueTest, spsc_put_get)
+{
+    spsc_t queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.capacity(), 8u);
+
+    EXPECT_TRUE(queue.put(1));
+    EXPECT_TRUE(queue.put(2));
+    EXPECT_EQ(queue.size(), 2u);
+
+    int value = 0;
+    EXPECT_TRUE(queue.get(value));
+    EXPECT_EQ(value, 1);
+    EXPECT_TRUE(queue.get(value));
+    EXPECT_EQ(value, 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(QueueTest, spsc_block_wraps)
+{
+    spsc_t queue;
+    std::vector<int> input(11);
+    std::iota(input.begin(), input.end(), 0);
+    std::vector<int> output(11);
+
+    EXPECT_EQ(queue.put_n(input.data(), 5), 5u);
+    EXPECT_EQ(queue.get_n(output.data(), 5), 5u);
+    EXPECT_EQ(queue.put_n(input.data() + 5, 6), 6u);  // wraps around the end
+    EXPECT_EQ(queue.size(), 6u);
+    EXPECT_EQ(queue.get_n(output.data() + 5, 6), 6u);
+    EXPECT_EQ(output, input);
+}
+
+TEST_F(QueueTest, spsc_timeout)
+{
+    spsc_t queue;
+    int value = 0;
+    EXPECT_FALSE(queue.get(value, std::chrono::milliseconds(10)));
+
+    std::vector<int> input(10, 1);
+    EXPECT_EQ(queue.put_n(input.data(), input.size(), std::chrono::milliseconds(10)), 8u);
+    EXPECT_FALSE(queue.put(2, std::chrono::milliseconds(0)));
+    EXPECT_FALSE(queue.put(2, std::chrono::milliseconds(10)));
+
+    std::vector<int> output(10);
+    EXPECT_EQ(queue.get_n(output.data(), output.size(), std::chrono::milliseconds(10)), 8u);
+}
+
+TEST_F(QueueTest, spsc_stats)
+{
+    spsc_t queue;
+    int value = 0;
+    for (int i = 0; i != 3; ++i) queue.put(i);
+    while (queue.get(value, std::chrono::milliseconds(0))) {}
+
+    auto stats = queue.stats();
+    EXPECT_EQ(stats.max_size, 3u);
+    EXPECT_EQ(stats.put_waits, 0u);
+    EXPECT_EQ(stats.get_waits, 1u);     // the get that found it empty
+
+    for (int i = 0; i != 8; ++i) queue.put(i);
+    EXPECT_FALSE(queue.put(8, std::chrono::milliseconds(0)));   // does not wait
+    EXPECT_FALSE(queue.put(8, std::chrono::milliseconds(10)));
+
+    stats = queue.stats();
+    EXPECT_EQ(stats.max_size, 8u);
+    EXPECT_EQ(stats.put_waits, 1u);
+    EXPECT_GE(stats.put_wait_time, std::chrono::milliseconds(10));
+}
+
+TEST_F(QueueTest, spsc_close)
+{
+    spsc_t queue;
+    EXPECT_TRUE(queue.put(1));
+    EXPECT_TRUE(queue.put(2));
+    queue.close();
+
+    EXPECT_FALSE(queue.is_open());
+    EXPECT_FALSE(queue.is_closed());    // not yet drained
+    EXPECT_FALSE(queue.put(3));
+
+    std::vector<int> output(4);
+    EXPECT_EQ(queue.get_n(output.data(), output.size()), 2u);
+    EXPECT_TRUE(queue.is_closed());
+
+    int value = 0;
+    EXPECT_FALSE(queue.get(value));
+}
+
+TEST_F(QueueTest, spsc_threads)
+{
+    // Blocks that do not divide the capacity, so both sides wrap and wait.
+    constexpr size_t total = 1000000;
+    mobilinkd::spsc_queue<uint32_t, 1920> queue;
+
+    std::thread producer([&queue]() {
+        std::vector<uint32_t> block(1000);
+        for (size_t i = 0; i < total; i += block.size())
+        {
+            std::iota(block.begin(), block.end(), uint32_t(i));
+            ASSERT_EQ(queue.put_n(block.data(), block.size()), block.size());
+        }
+        queue.close();
+    });
+
+    std::vector<uint32_t> block(1920);
+    size_t expected = 0;
+    bool in_order = true;
+    while (size_t n = queue.get_n(block.data(), block.size()))
+    {
+        for (size_t i = 0; i != n; ++i) in_order &= block[i] == expected++;
+    }
+    producer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_EQ(expected, total);
+    EXPECT_TRUE(queue.is_closed());
+}
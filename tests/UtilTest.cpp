@@ -2,8 +2,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <bit>
+#include <cmath>
 #include <cstdint>
+#include <limits>
+#include <vector>
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -103,6 +107,65 @@ TEST_F(UtilTest, llr_not_zero)
     }
 }
 
+namespace {
+
+// The original mapper: a binary search of the LLR map.
+template <typename FloatType>
+std::tuple<int8_t, int8_t> llr_search(FloatType sample)
+{
+    static constexpr auto symbol_map = mobilinkd::detail::make_llr_map<FloatType, 4>();
+    FloatType s = std::min(FloatType(3), std::max(FloatType(-3), sample));
+    auto it = std::lower_bound(symbol_map.begin(), symbol_map.end(), s,
+        [](std::tuple<FloatType, std::tuple<int8_t, int8_t>> const& e, FloatType s){
+            return std::get<0>(e) < s;
+        });
+    if (it == symbol_map.end()) return std::get<1>(*symbol_map.rbegin());
+    return std::get<1>(*it);
+}
+
+// A sweep of the symbol range, plus every value within a few ulps of
+// each map key, where the index estimate is most likely to be off.
+template <typename FloatType>
+std::vector<FloatType> llr_inputs()
+{
+    std::vector<FloatType> result;
+    for (FloatType v = -4; v < 4; v += FloatType(0.0001)) result.push_back(v);
+    for (const auto& e : mobilinkd::detail::make_llr_map<FloatType, 4>())
+    {
+        FloatType v = std::get<0>(e);
+        for (int i = 0; i != 8; ++i) v = std::nextafter(v, FloatType(-4));
+        for (int i = 0; i != 17; ++i, v = std::nextafter(v, FloatType(4))) result.push_back(v);
+    }
+    result.push_back(std::numeric_limits<FloatType>::quiet_NaN());
+    result.push_back(std::numeric_limits<FloatType>::infinity());
+    result.push_back(-std::numeric_limits<FloatType>::infinity());
+    return result;
+}
+
+template <typename FloatType>
+void check_llr_matches_search()
+{
+    auto input = llr_inputs<FloatType>();
+    std::vector<int8_t> block(input.size() * 2);
+    mobilinkd::llr<FloatType, 4>(input.data(), input.size(), block.data());
+
+    for (size_t i = 0; i != input.size(); ++i)
+    {
+        auto expected = llr_search<FloatType>(input[i]);
+        EXPECT_EQ((mobilinkd::llr<FloatType, 4>(input[i])), expected) << input[i];
+        EXPECT_EQ(block[i * 2], std::get<0>(expected)) << input[i];
+        EXPECT_EQ(block[i * 2 + 1], std::get<1>(expected)) << input[i];
+    }
+}
+
+} // namespace
+
+TEST_F(UtilTest, llr_matches_search)
+{
+    check_llr_matches_search<float>();
+    check_llr_matches_search<double>();
+}
+
 TEST_F(UtilTest, llr_near_zero)
 {
     {
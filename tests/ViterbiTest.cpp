@@ -2,11 +2,14 @@
 #include "Trellis.h"
 #include "Util.h"
 #include "Numerology.h"
+#include "EncodeLlr.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <chrono>
+#include <vector>
 
 // make CXXFLAGS="$(pkg-config --cflags gtest) $(pkg-config --libs gtest) -I. -O3 -std=c++17" tests/ViterbiTest
 
@@ -195,3 +198,148 @@ TEST_F(ViterbiTest, decode_ber_lsf)
 
 }
 
+
+TEST_F(ViterbiTest, simd_matches_scalar)
+{
+    std::array<int8_t, mobilinkd::stream_type3_payload_size> encoded;
+    std::array<uint8_t, mobilinkd::stream_frame_payload_size> scalar_output;
+    std::array<uint8_t, mobilinkd::stream_frame_payload_size> simd_output;
+
+    mobilinkd::Trellis<4,2> trellis({mobilinkd::ConvolutionPolyA,mobilinkd::ConvolutionPolyB});
+    mobilinkd::Viterbi<decltype(trellis), 4> scalar(trellis);
+    mobilinkd::Viterbi<decltype(trellis), 4> simd(trellis);
+    scalar.simd_ = mobilinkd::SimdLevel::SCALAR;
+
+    std::cout << "SIMD level: " << int(simd.simd_) << std::endl;
+
+    srand(17);
+    for (size_t frame = 0; frame != 20; ++frame)
+    {
+        // Random LLRs in [-7, 7], including erasures.
+        for (auto& e : encoded) e = rand() % 15 - 7;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto scalar_cost = scalar.decode(encoded, scalar_output);
+        auto mid = std::chrono::high_resolution_clock::now();
+        auto simd_cost = simd.decode(encoded, simd_output);
+        auto end = std::chrono::high_resolution_clock::now();
+        if (frame == 0)
+        {
+            std::cout << "Scalar: " << (mid - start).count() << "ns, SIMD: " << (end - mid).count() << "ns" << std::endl;
+        }
+
+        EXPECT_EQ(scalar_cost, simd_cost);
+        EXPECT_EQ(scalar_output, simd_output);
+        EXPECT_EQ(scalar.prevMetrics, simd.prevMetrics);
+    }
+}
+
+TEST_F(ViterbiTest, simd_kernels_match_scalar)
+{
+    std::array<int8_t, mobilinkd::stream_type3_payload_size> encoded;
+    std::array<uint8_t, mobilinkd::stream_frame_payload_size> scalar_output;
+    std::array<uint8_t, mobilinkd::stream_frame_payload_size> simd_output;
+
+    mobilinkd::Trellis<4,2> trellis({mobilinkd::ConvolutionPolyA,mobilinkd::ConvolutionPolyB});
+    mobilinkd::Viterbi<decltype(trellis), 4> scalar(trellis);
+    mobilinkd::Viterbi<decltype(trellis), 4> simd(trellis);
+    scalar.simd_ = mobilinkd::SimdLevel::SCALAR;
+
+    // Every kernel up to the one this CPU supports.
+    std::vector<mobilinkd::SimdLevel> levels;
+    auto best = mobilinkd::simd_level();
+    if (best == mobilinkd::SimdLevel::NEON) levels.push_back(best);
+    if (best == mobilinkd::SimdLevel::SSE2 || best == mobilinkd::SimdLevel::AVX2) levels.push_back(mobilinkd::SimdLevel::SSE2);
+    if (best == mobilinkd::SimdLevel::AVX2) levels.push_back(best);
+
+    srand(23);
+    for (auto level : levels)
+    {
+        simd.simd_ = level;
+        for (size_t frame = 0; frame != 20; ++frame)
+        {
+            // Full-range int8 inputs to exercise the int16 metric bounds.
+            for (auto& e : encoded) e = rand() % 256 - 128;
+            if (frame & 1) for (auto& e : encoded) e = e / 18;
+
+            auto scalar_cost = scalar.decode(encoded, scalar_output);
+            auto simd_cost = simd.decode(encoded, simd_output);
+
+            EXPECT_EQ(scalar_cost, simd_cost) << "level " << int(level);
+            EXPECT_EQ(scalar_output, simd_output) << "level " << int(level);
+            EXPECT_EQ(scalar.prevMetrics, simd.prevMetrics) << "level " << int(level);
+        }
+    }
+}
+
+TEST_F(ViterbiTest, streaming_matches_block)
+{
+    std::array<uint8_t, mobilinkd::stream_frame_payload_bytes> payload;
+    std::array<uint8_t, mobilinkd::stream_frame_payload_size> block_output;
+
+    mobilinkd::Trellis<4,2> trellis({mobilinkd::ConvolutionPolyA,mobilinkd::ConvolutionPolyB});
+    mobilinkd::Viterbi<decltype(trellis), 4> viterbi(trellis);
+
+    std::vector<uint8_t> streamed;
+    mobilinkd::StreamingViterbi<decltype(trellis), 4> streaming(trellis,
+        [&streamed](const uint8_t* data, size_t len) { streamed.insert(streamed.end(), data, data + len); });
+
+    srand(31);
+    for (size_t frame = 0; frame != 10; ++frame)
+    {
+        for (auto& b : payload) b = rand() & 0xFF;
+        auto encoded = encode_llr(payload);
+        static_assert(encoded.size() == mobilinkd::stream_type3_payload_size);
+
+        // Isolated errors and erasures that both decoders correct.
+        for (size_t i = 37; i < encoded.size(); i += 97)
+        {
+            encoded[i] = (i & 1) ? 0 : -encoded[i];
+        }
+
+        auto block_cost = viterbi.decode(encoded, block_output);
+        auto block_bytes = mobilinkd::to_byte_array(block_output);
+        ASSERT_EQ(block_bytes, payload);
+
+        // Feed the stream in odd-sized pieces.
+        streamed.clear();
+        size_t pos = 0;
+        while (pos != encoded.size())
+        {
+            size_t len = std::min<size_t>(rand() % 50 + 1, encoded.size() - pos);
+            streaming.decode(encoded.data() + pos, len);
+            pos += len;
+        }
+        auto stream_cost = streaming.flush();
+
+        ASSERT_EQ(streamed.size(), payload.size());
+        EXPECT_TRUE(std::equal(streamed.begin(), streamed.end(), payload.begin()));
+        EXPECT_EQ(stream_cost, block_cost);
+    }
+}
+
+TEST_F(ViterbiTest, streaming_output_is_incremental)
+{
+    std::array<uint8_t, mobilinkd::stream_frame_payload_bytes> payload;
+    for (size_t i = 0; i != payload.size(); ++i) payload[i] = i * 7;
+    auto encoded = encode_llr(payload);
+
+    mobilinkd::Trellis<4,2> trellis({mobilinkd::ConvolutionPolyA,mobilinkd::ConvolutionPolyB});
+    size_t received = 0;
+    mobilinkd::StreamingViterbi<decltype(trellis), 4> streaming(trellis,
+        [&](const uint8_t* data, size_t len) {
+            for (size_t i = 0; i != len; ++i) EXPECT_EQ(data[i], payload[received + i]);
+            received += len;
+        });
+
+    // Bits are decided once depth + BLOCK steps are pending.
+    size_t half = encoded.size() / 2;
+    streaming.decode(encoded.data(), half);
+    size_t lag = streaming.depth_ + streaming.BLOCK;
+    EXPECT_GE(received * 8 + lag, half / 2);
+    EXPECT_GT(received, 0);
+
+    streaming.decode(encoded.data() + half, encoded.size() - half);
+    streaming.flush();
+    EXPECT_EQ(received, payload.size());
+}